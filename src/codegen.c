@@ -1,18 +1,31 @@
 
 #include <stdio.h>
+#include <stdint.h>
+#include <math.h>
 #include "codegen.h"
 
 #define WRITE(s) stringbuilder_push_nt_string(out, s)
 #define WRITE_S(s) stringbuilder_push_string(out, s)
 #define WRITE_C(c) stringbuilder_push_char(out, c)
 
+// declared records are identified by their path and variant, other
+// declared types by their type node (a copy, as it may be a temporary)
 typedef struct RecordEntry {
     Namespace path;
     size_t variant;
+    bool is_structural;
+    Node type;
 } RecordEntry;
 
 DEF_ARRAY_BUILDER(RecordEntry)
 
+static void emit_size(size_t n, StringBuilder* out) {
+    size_t n_str_len = snprintf(NULL, 0, "%zu", n);
+    char n_str[n_str_len + 1];
+    sprintf(n_str, "%zu", n);
+    stringbuilder_push(out, n_str_len, n_str);
+}
+
 static void emit_path_element(String* element, StringBuilder* out) {
     for(size_t i = 0; i < element->length; i += 1) {
         char c = string_char_at(*element, i);
@@ -27,10 +40,7 @@ static void emit_path(Namespace* path, size_t variant, StringBuilder* out) {
         emit_path_element(path->elements + i, out);
     }
     WRITE_C('_');
-    size_t variant_str_len = snprintf(NULL, 0, "%zu", variant);
-    char variant_str[variant_str_len];
-    sprintf(variant_str, "%zu", variant);
-    stringbuilder_push(out, variant_str_len, variant_str);
+    emit_size(variant, out);
 }
 
 #define WRITE_TYPE(t) \
@@ -52,12 +62,238 @@ static bool namespace_eq(Namespace a, Namespace b) {
     return true;
 }
 
+// the largest alignment given by 'align N' or 'cacheline', 0 if none
+// (the attributes are checked by the parser)
+static size_t attribute_alignment(Attributes* a) {
+    size_t alignment = 0;
+    for(size_t ai = 0; ai < a->length; ai += 1) {
+        Attribute* attribute = a->attributes + ai;
+        size_t given = 0;
+        if(string_eq(attribute->name, string_wrap_nt("cacheline"))) {
+            given = 64;
+        }
+        if(string_eq(attribute->name, string_wrap_nt("align"))) {
+            STRING_AS_NT(attribute->value, digits);
+            given = strtoull(digits, NULL, 10);
+        }
+        if(given > alignment) { alignment = given; }
+    }
+    return alignment;
+}
+
+static size_t core_type_size(String name) {
+    const char* names[] = {
+        "unit", "bool", "u8", "s8", "u16", "s16", "u32", "s32", "f32",
+        "u64", "s64", "f64", "usize", "ssize", NULL
+    };
+    const size_t sizes[] = { 1, 1, 1, 1, 2, 2, 4, 4, 4, 8, 8, 8, 8, 8 };
+    for(size_t ni = 0; names[ni] != NULL; ni += 1) {
+        if(string_eq(name, string_wrap_nt(names[ni]))) { return sizes[ni]; }
+    }
+    panic("UNHANDLED CORE TYPE!");
+}
+
+static size_t record_alignment(
+    Namespace path, size_t variant, SymbolTable* symbols
+);
+
+// the alignment of a type in the emitted C code
+static size_t type_alignment(Node* n, SymbolTable* symbols) {
+    switch(n->type) {
+        case NAMESPACE_ACCESS_NODE:
+            if(ir_type_is_atomic(n)) {
+                return type_alignment(
+                    n->value.namespace_access.template_argv, symbols
+                );
+            }
+            if(ir_type_is_soa(n) || ir_type_is_task(n)) {
+                return _Alignof(void*);
+            }
+            // vectors are aligned to their size
+            if(ir_type_is_vector(n)) {
+                return ir_vector_lanes(n)
+                    * core_type_size(ir_vector_element(n));
+            }
+            if(n->value.namespace_access.path.length == 1
+                && s_table_lookup(symbols, n->value.namespace_access.path)
+                    == NULL) {
+                return core_type_size(
+                    n->value.namespace_access.path.elements[0]
+                );
+            }
+            return record_alignment(
+                n->value.namespace_access.path,
+                n->value.namespace_access.variant,
+                symbols
+            );
+        case POINTER_TYPE_NODE:
+        case SLICE_TYPE_NODE:
+            return _Alignof(void*);
+        case ARRAY_TYPE_NODE:
+            return type_alignment(n->value.array_type.of, symbols);
+        default:
+            panic("UNHANDLED TYPE NODE!");
+    }
+}
+
+static size_t member_alignment(Node* record, size_t argi, SymbolTable* s) {
+    size_t given = attribute_alignment(
+        record->value.record.argattributev + argi
+    );
+    size_t natural = type_alignment(record->value.record.argtypev + argi, s);
+    return given > natural? given : natural;
+}
+
+static size_t record_alignment(
+    Namespace path, size_t variant, SymbolTable* symbols
+) {
+    Node* record = s_table_lookup(symbols, path)->variants + variant;
+    if(record->type == UNION_NODE) {
+        size_t alignment = ir_union_tag_bits(record) / 8;
+        for(size_t casei = 0; casei < record->value.tagged_union.casec;
+            casei += 1) {
+            Node* case_type = record->value.tagged_union.casetypev + casei;
+            if(ir_type_is_unit(case_type)) { continue; }
+            size_t of_case = type_alignment(case_type, symbols);
+            if(of_case > alignment) { alignment = of_case; }
+        }
+        return alignment;
+    }
+    size_t alignment = attribute_alignment(&record->value.record.attributes);
+    for(size_t argi = 0; argi < record->value.record.argc; argi += 1) {
+        size_t of_member = member_alignment(record, argi, symbols);
+        if(of_member > alignment) { alignment = of_member; }
+    }
+    return alignment == 0? 1 : alignment;
+}
+
+// the order of the members in the emitted struct, 'order' needs space for
+// all of them
+static void member_order(Node* record, size_t* order, SymbolTable* symbols) {
+    size_t argc = record->value.record.argc;
+    for(size_t argi = 0; argi < argc; argi += 1) { order[argi] = argi; }
+    // 'reorder' sorts the members by decreasing alignment (keeping the order
+    // of equally aligned ones) to minimize padding
+    if(!attributes_find(&record->value.record.attributes, "reorder")) {
+        return;
+    }
+    for(size_t argi = 1; argi < argc; argi += 1) {
+        size_t moved = order[argi];
+        size_t alignment = member_alignment(record, moved, symbols);
+        size_t to = argi;
+        while(to > 0
+            && member_alignment(record, order[to - 1], symbols) < alignment) {
+            order[to] = order[to - 1];
+            to -= 1;
+        }
+        order[to] = moved;
+    }
+}
+
+static size_t record_size(
+    Namespace path, size_t variant, SymbolTable* symbols
+);
+
+// the size of a type in the emitted C code
+static size_t type_size(Node* n, SymbolTable* symbols) {
+    switch(n->type) {
+        case NAMESPACE_ACCESS_NODE:
+            if(ir_type_is_atomic(n)) {
+                return type_size(
+                    n->value.namespace_access.template_argv, symbols
+                );
+            }
+            if(ir_type_is_soa(n)) {
+                // one slice for each member of the record
+                Node* row = n->value.namespace_access.template_argv;
+                Node* record = s_table_lookup(
+                    symbols, row->value.namespace_access.path
+                )->variants + row->value.namespace_access.variant;
+                return record->value.record.argc * 2 * sizeof(void*);
+            }
+            // the resume function and the frame
+            if(ir_type_is_task(n)) { return 2 * sizeof(void*); }
+            if(ir_type_is_vector(n)) {
+                return ir_vector_lanes(n)
+                    * core_type_size(ir_vector_element(n));
+            }
+            if(n->value.namespace_access.path.length == 1
+                && s_table_lookup(symbols, n->value.namespace_access.path)
+                    == NULL) {
+                return core_type_size(
+                    n->value.namespace_access.path.elements[0]
+                );
+            }
+            return record_size(
+                n->value.namespace_access.path,
+                n->value.namespace_access.variant,
+                symbols
+            );
+        case POINTER_TYPE_NODE:
+            return sizeof(void*);
+        case SLICE_TYPE_NODE:
+            return sizeof(void*) + sizeof(size_t);
+        case ARRAY_TYPE_NODE:
+            return ir_array_length(n)
+                * type_size(n->value.array_type.of, symbols);
+        default:
+            panic("UNHANDLED TYPE NODE!");
+    }
+}
+
+static size_t align_up(size_t n, size_t alignment) {
+    return (n + alignment - 1) / alignment * alignment;
+}
+
+static size_t record_size(
+    Namespace path, size_t variant, SymbolTable* symbols
+) {
+    Node* record = s_table_lookup(symbols, path)->variants + variant;
+    if(record->type == UNION_NODE) {
+        size_t casec = record->value.tagged_union.casec;
+        if(ir_union_niche(record) < casec) { return sizeof(void*); }
+        size_t data_size = 0;
+        for(size_t casei = 0; casei < casec; casei += 1) {
+            Node* case_type = record->value.tagged_union.casetypev + casei;
+            if(ir_type_is_unit(case_type)) { continue; }
+            size_t of_case = type_size(case_type, symbols);
+            if(of_case > data_size) { data_size = of_case; }
+        }
+        size_t alignment = record_alignment(path, variant, symbols);
+        size_t size = align_up(ir_union_tag_bits(record) / 8, alignment);
+        return align_up(size + data_size, alignment);
+    }
+    size_t argc = record->value.record.argc;
+    size_t order[argc + 1];
+    member_order(record, order, symbols);
+    size_t size = 0;
+    for(size_t orderi = 0; orderi < argc; orderi += 1) {
+        size_t argi = order[orderi];
+        size = align_up(size, member_alignment(record, argi, symbols));
+        size += type_size(record->value.record.argtypev + argi, symbols);
+    }
+    return align_up(size, record_alignment(path, variant, symbols));
+}
+
+// arguments and returned values larger than this are passed through pointers
+#define LARGE_VALUE_SIZE 64
+
+static bool is_large_value(Node* type, SymbolTable* symbols) {
+    bool is_record = type->type == NAMESPACE_ACCESS_NODE
+        && !ir_type_is_atomic(type) && !ir_type_is_soa(type)
+        && !ir_type_is_vector(type) && !ir_type_is_task(type)
+        && s_table_lookup(symbols, type->value.namespace_access.path) != NULL;
+    if(!is_record && type->type != ARRAY_TYPE_NODE) { return false; }
+    return type_size(type, symbols) > LARGE_VALUE_SIZE;
+}
+
 static void declare_type(
     Namespace path, size_t variant, SymbolTable* symbols,
     StringBuilder* typesdefs, ArrayBuilder(RecordEntry)* types
 ) {
     for(size_t typei = 0; typei < types->length; typei += 1) {
         RecordEntry* entry = ((RecordEntry*) types->buffer) + typei;
+        if(entry->is_structural) { continue; }
         if(namespace_eq(path, entry->path) && variant == entry->variant) {
             return;
         }
@@ -69,15 +305,39 @@ static void declare_type(
     if(variant >= s->variant_count) { return; }
     Node* symbol = s->variants + variant;
     arraybuilder_push(RecordEntry)(types, (RecordEntry) {
-        .path = path, .variant = variant
+        .path = path, .variant = variant, .is_structural = false
     });
     switch(symbol->type) {
-        case RECORD_NODE:
+        case RECORD_NODE: {
+            size_t argc = symbol->value.record.argc;
+            size_t order[argc + 1];
+            member_order(symbol, order, symbols);
             WRITE("typedef struct ");
             emit_path(&symbol->value.record.path, variant, out);
             WRITE(" { ");
-            for(size_t argi = 0; argi < symbol->value.record.argc; argi += 1) {
-                WRITE_TYPE(symbol->value.record.argtypev + argi);
+            for(size_t orderi = 0; orderi < argc; orderi += 1) {
+                size_t argi = order[orderi];
+                Node* argtype = symbol->value.record.argtypev + argi;
+                size_t alignment = attribute_alignment(
+                    symbol->value.record.argattributev + argi
+                );
+                // the alignment of the record is that of its first member,
+                // which also makes its size a multiple of it
+                size_t of_record = attribute_alignment(
+                    &symbol->value.record.attributes
+                );
+                if(orderi == 0 && of_record > alignment) {
+                    alignment = of_record;
+                }
+                // alignments weaker than the type's own are not allowed in
+                // C, so the stricter of both is given
+                if(alignment > 0) {
+                    size_t natural = type_alignment(argtype, symbols);
+                    WRITE("_Alignas(");
+                    emit_size(alignment > natural? alignment : natural, out);
+                    WRITE(") ");
+                }
+                WRITE_TYPE(argtype);
                 WRITE_C(' ');
                 WRITE_S(symbol->value.record.argnamev[argi]);
                 WRITE("; ");
@@ -86,6 +346,205 @@ static void declare_type(
             emit_path(&symbol->value.record.path, variant, out);
             WRITE(";\n");
             break;
+        }
+        case UNION_NODE: {
+            size_t casec = symbol->value.tagged_union.casec;
+            String* casenamev = symbol->value.tagged_union.casenamev;
+            Node* casetypev = symbol->value.tagged_union.casetypev;
+            WRITE("typedef struct ");
+            emit_path(&symbol->value.tagged_union.path, variant, out);
+            WRITE(" { ");
+            size_t niche = ir_union_niche(symbol);
+            if(niche < casec) {
+                // null stands for the other case
+                WRITE_TYPE(casetypev + niche);
+                WRITE_C(' ');
+                WRITE_S(casenamev[niche]);
+                WRITE("; ");
+            } else {
+                WRITE("uint");
+                emit_size(ir_union_tag_bits(symbol), out);
+                WRITE("_t tag; ");
+                bool has_data = false;
+                for(size_t casei = 0; casei < casec; casei += 1) {
+                    if(ir_type_is_unit(casetypev + casei)) { continue; }
+                    if(!has_data) { WRITE("union { "); }
+                    has_data = true;
+                    WRITE_TYPE(casetypev + casei);
+                    WRITE_C(' ');
+                    WRITE_S(casenamev[casei]);
+                    WRITE("; ");
+                }
+                if(has_data) { WRITE("} data; "); }
+            }
+            WRITE("} ");
+            emit_path(&symbol->value.tagged_union.path, variant, out);
+            WRITE(";\n");
+            break;
+        }
+    }
+    stringbuilder_push(typesdefs, decl.length, decl.buffer);
+    stringbuilder_free(&decl);
+}
+
+// writes a name for a type that can be used as part of a C identifier
+static void emit_type_name(Node* n, StringBuilder* out) {
+    switch(n->type) {
+        case NAMESPACE_ACCESS_NODE:
+            if(ir_type_is_soa(n)) {
+                WRITE("soa_");
+                emit_type_name(n->value.namespace_access.template_argv, out);
+                return;
+            }
+            if(ir_type_is_atomic(n)) {
+                WRITE("atomic_");
+                emit_type_name(n->value.namespace_access.template_argv, out);
+                return;
+            }
+            if(n->value.namespace_access.path.length == 1) {
+                emit_path_element(n->value.namespace_access.path.elements, out);
+                return;
+            }
+            emit_path(
+                &n->value.namespace_access.path,
+                n->value.namespace_access.variant,
+                out
+            );
+            return;
+        case POINTER_TYPE_NODE:
+            if(n->value.pointer_type.is_const) { WRITE("const_"); }
+            if(n->value.pointer_type.is_restrict) { WRITE("restrict_"); }
+            WRITE("ptr_");
+            emit_type_name(n->value.pointer_type.to, out);
+            return;
+        case ARRAY_TYPE_NODE:
+            WRITE("array_");
+            emit_size(ir_array_length(n), out);
+            WRITE_C('_');
+            emit_type_name(n->value.array_type.of, out);
+            return;
+        case SLICE_TYPE_NODE:
+            WRITE("slice_");
+            emit_type_name(n->value.slice_type.of, out);
+            return;
+        default:
+            panic("UNHANDLED TYPE NODE!");
+    }
+}
+
+// types without a declaration in the source (like arrays) are emitted as
+// structs named after the type, which never collide with record paths
+static void emit_type_typedef_name(Node* n, StringBuilder* out) {
+    emit_type_name(n, out);
+    WRITE("_t");
+}
+
+static void declare_structural_type(
+    Node* n, SymbolTable* symbols,
+    StringBuilder* typesdefs, ArrayBuilder(RecordEntry)* types
+) {
+    for(size_t typei = 0; typei < types->length; typei += 1) {
+        RecordEntry* entry = ((RecordEntry*) types->buffer) + typei;
+        if(entry->is_structural && template_arg_eq(&entry->type, n)) {
+            return;
+        }
+    }
+    arraybuilder_push(RecordEntry)(types, (RecordEntry) {
+        .is_structural = true, .type = *n
+    });
+    StringBuilder decl = stringbuilder_new();
+    StringBuilder* out = &decl;
+    switch(n->type) {
+        case NAMESPACE_ACCESS_NODE: {
+            if(ir_type_is_task(n)) {
+                // the frame is copied to memory owned by the task
+                WRITE(
+                    "typedef struct task_t {"
+                    " bool (*resume)(void*); void* frame;"
+                    " } task_t;\n"
+                    "static inline task_t nino_task_new(\n"
+                    "    bool (*resume)(void*), const void* frame,"
+                    " size_t size\n"
+                    ") {\n"
+                    "    void* copy = __builtin_malloc(size);\n"
+                    "    if(copy == NULL) { __builtin_trap(); }\n"
+                    "    __builtin_memcpy(copy, frame, size);\n"
+                    "    return (task_t) { .resume = resume, .frame = copy };\n"
+                    "}\n"
+                    "static inline bool nino_task_resume(task_t task) {\n"
+                    "    return task.resume(task.frame);\n"
+                    "}\n"
+                    "static inline void nino_task_free(task_t task) {\n"
+                    "    __builtin_free(task.frame);\n"
+                    "}\n"
+                );
+                break;
+            }
+            if(ir_type_is_soa(n)) {
+                // one slice for each member of the record
+                Node* row = n->value.namespace_access.template_argv;
+                Node* record = s_table_lookup(
+                    symbols, row->value.namespace_access.path
+                )->variants + row->value.namespace_access.variant;
+                size_t argc = record->value.record.argc;
+                WRITE("typedef struct ");
+                emit_type_typedef_name(n, out);
+                WRITE(" { ");
+                for(size_t argi = 0; argi < argc; argi += 1) {
+                    Node column = (Node) {
+                        .type = SLICE_TYPE_NODE,
+                        .value = { .slice_type = {
+                            .of = record->value.record.argtypev + argi
+                        } }
+                    };
+                    WRITE_TYPE(&column);
+                    WRITE_C(' ');
+                    WRITE_S(record->value.record.argnamev[argi]);
+                    WRITE("; ");
+                }
+                WRITE("} ");
+                emit_type_typedef_name(n, out);
+                WRITE(";\n");
+                break;
+            }
+            // vectors use the GCC / Clang vector extension
+            String element = ir_vector_element(n);
+            Node element_type = *n;
+            element_type.value.namespace_access.path.elements = &element;
+            WRITE("typedef ");
+            WRITE_TYPE(&element_type);
+            WRITE_C(' ');
+            emit_type_typedef_name(n, out);
+            WRITE(" __attribute__((vector_size(");
+            emit_size(ir_vector_lanes(n), out);
+            WRITE(" * sizeof(");
+            WRITE_TYPE(&element_type);
+            WRITE("))));\n");
+            break;
+        }
+        case ARRAY_TYPE_NODE:
+            // wrapped in a struct to be assignable like any other value
+            WRITE("typedef struct ");
+            emit_type_typedef_name(n, out);
+            WRITE(" { ");
+            WRITE_TYPE(n->value.array_type.of);
+            WRITE(" data[");
+            emit_size(ir_array_length(n), out);
+            WRITE("]; } ");
+            emit_type_typedef_name(n, out);
+            WRITE(";\n");
+            break;
+        case SLICE_TYPE_NODE:
+            WRITE("typedef struct ");
+            emit_type_typedef_name(n, out);
+            WRITE(" { ");
+            WRITE_TYPE(n->value.slice_type.of);
+            WRITE("* data; size_t length; } ");
+            emit_type_typedef_name(n, out);
+            WRITE(";\n");
+            break;
+        default:
+            panic("UNHANDLED TYPE NODE!");
     }
     stringbuilder_push(typesdefs, decl.length, decl.buffer);
     stringbuilder_free(&decl);
@@ -121,6 +580,18 @@ static void emit_type(
                 EMIT_CORE_TYPE("unit", "void");
                 EMIT_CORE_TYPE("bool", "bool");
             }
+            if(ir_type_is_vector(n) || ir_type_is_soa(n)
+                || ir_type_is_task(n)) {
+                declare_structural_type(n, symbols, typesdefs, types);
+                emit_type_typedef_name(n, out);
+                return;
+            }
+            if(ir_type_is_atomic(n)) {
+                WRITE("_Atomic(");
+                WRITE_TYPE(n->value.namespace_access.template_argv);
+                WRITE_C(')');
+                return;
+            }
             declare_type(
                 n->value.namespace_access.path,
                 n->value.namespace_access.variant,
@@ -132,334 +603,1271 @@ static void emit_type(
                 out
             );
             return;
-        case POINTER_TYPE_NODE:
-            WRITE_TYPE(n->value.pointer_type.to);
+        case POINTER_TYPE_NODE: {
+            Node* to = n->value.pointer_type.to;
+            // 'const T*' would make the pointer itself const if 'T' is one
+            bool is_const = n->value.pointer_type.is_const;
+            bool const_before = is_const && to->type != POINTER_TYPE_NODE;
+            if(const_before) { WRITE("const "); }
+            WRITE_TYPE(to);
+            if(is_const && !const_before) { WRITE(" const"); }
             WRITE_C('*');
+            if(n->value.pointer_type.is_restrict) { WRITE(" restrict"); }
+            return;
+        }
+        case ARRAY_TYPE_NODE:
+        case SLICE_TYPE_NODE:
+            declare_structural_type(n, symbols, typesdefs, types);
+            emit_type_typedef_name(n, out);
             return;
         default:
             panic("UNHANDLED TYPE NODE!");
     }
 }
 
-static void emit_block(
-    Block block, SymbolTable* symbols,
+static void emit_local_name(
+    IrFunction* f, size_t local, StringBuilder* out
+) {
+    IrLocal* l = f->locals + local;
+    if(l->is_temporary) {
+        WRITE_C('_');
+        emit_size(local, out);
+        return;
+    }
+    WRITE_S(l->name);
+    for(size_t locali = 0; locali < local; locali += 1) {
+        if(f->locals[locali].is_temporary) { continue; }
+        if(!string_eq(f->locals[locali].name, l->name)) { continue; }
+        WRITE("__");
+        emit_size(local, out);
+        return;
+    }
+}
+
+// arguments passed through a pointer are read through it, the locals of
+// async functions mostly live in their frame
+static void emit_local(IrFunction* f, size_t local, StringBuilder* out) {
+    if(f->locals[local].is_in_frame) {
+        WRITE("frame->");
+        emit_local_name(f, local, out);
+        return;
+    }
+    if(!f->locals[local].is_by_pointer) {
+        emit_local_name(f, local, out);
+        return;
+    }
+    WRITE("(*");
+    emit_local_name(f, local, out);
+    WRITE_C(')');
+}
+
+// opaque pointers are declared as 'void*'
+static void emit_local_type(
+    IrFunction* f, size_t local, SymbolTable* symbols,
     StringBuilder* typesdefs, ArrayBuilder(RecordEntry)* types,
     StringBuilder* out
-);
+) {
+    if(f->locals[local].is_opaque_pointer) { WRITE("void*"); }
+    else { WRITE_TYPE(f->locals[local].type); }
+}
 
-#define WRITE_NODE(n) { \
-    WRITE_C('('); \
-    emit_node(n, symbols, typesdefs, types, out); \
-    WRITE_C(')'); \
+static void emit_return_type(
+    IrFunction* f, Node* return_type, SymbolTable* symbols,
+    StringBuilder* typesdefs, ArrayBuilder(RecordEntry)* types,
+    StringBuilder* out
+) {
+    if(f != NULL && f->returns_by_pointer) { WRITE("void"); }
+    else if(f != NULL && f->returns_opaque_pointer) { WRITE("void*"); }
+    else { WRITE_TYPE(return_type); }
 }
 
-static void emit_node(
-    Node* node, SymbolTable* symbols,
+#define WRITE_VALUE(v) \
+    emit_value(f, v, symbols, typesdefs, types, out)
+#define WRITE_PLACE(p) \
+    emit_place(f, p, symbols, typesdefs, types, out)
+
+static void emit_value(
+    IrFunction* f, IrValue* v, SymbolTable* symbols,
     StringBuilder* typesdefs, ArrayBuilder(RecordEntry)* types,
     StringBuilder* out
 ) {
-    switch(node->type) {
-        // case UNIT_LITERAL_NODE:
-        // case MODULE_NODE:
-        // case USE_NODE:
-        // case FUNCTION_NODE:
-        // case EXTERNAL_FUNCTION_NODE:
-        // case RECORD_NODE:
-        // case POINTER_TYPE_NODE:
-        case INTEGER_LITERAL_NODE:
-            WRITE_S(node->value.integer_literal.value);
-            break;
-        case FLOAT_LITERAL_NODE:
-            WRITE_S(node->value.float_literal.value);
-            break;
-        case STRING_LITERAL_NODE:
-            WRITE_S(node->value.string_literal.value);
-            break;
-        case BOOLEAN_LITERAL_NODE:
-            WRITE_S(node->value.boolean_literal.value);
-            break;
-        case VARIABLE_NODE:
-            WRITE_S(node->value.variable.name);
-            break;
-        case VARIABLE_DECLARATION_NODE:
-            WRITE_TYPE(node->value.variable_declaration.type);
-            WRITE_C(' ');
-            WRITE_S(node->value.variable_declaration.name);
-            WRITE(" = ");
-            WRITE_NODE(node->value.variable_declaration.value);
+    bool is_signed_literal = (v->type == IR_VALUE_INTEGER
+        || v->type == IR_VALUE_FLOAT) && (
+            string_char_at(v->value.literal, 0) == '-'
+            || string_char_at(v->value.literal, 0) == '+'
+        );
+    switch(v->type) {
+        case IR_VALUE_NONE:
+            panic("Unit value used as a C value!");
+        case IR_VALUE_LOCAL:
+            emit_local(f, v->value.local, out);
             break;
-        case ASSIGNMENT_NODE:
-            WRITE_NODE(node->value.assignment.to);
-            WRITE(" = ");
-            WRITE_NODE(node->value.assignment.value);
+        case IR_VALUE_INTEGER:
+            // the C type of an integer literal is 'int' unless it is cast
+            bool is_wide = ir_type_is_core(v->data_type, "u64")
+                || ir_type_is_core(v->data_type, "s64")
+                || ir_type_is_core(v->data_type, "usize")
+                || ir_type_is_core(v->data_type, "ssize");
+            if(is_wide) {
+                WRITE("((");
+                WRITE_TYPE(v->data_type);
+                WRITE(") ");
+            } else if(is_signed_literal) { WRITE_C('('); }
+            WRITE_S(v->value.literal);
+            if(is_wide || is_signed_literal) { WRITE_C(')'); }
             break;
-        case ADDITION_NODE:
-            WRITE_NODE(node->value.addition.a);
-            WRITE(" + ");
-            WRITE_NODE(node->value.addition.b);
+        case IR_VALUE_FLOAT:
+            if(is_signed_literal) { WRITE_C('('); }
+            WRITE_S(v->value.literal);
+            if(ir_type_is_core(v->data_type, "f32")) { WRITE_C('f'); }
+            if(is_signed_literal) { WRITE_C(')'); }
             break;
-        case SUBTRACTION_NODE:
-            WRITE_NODE(node->value.subtraction.a);
-            WRITE(" - ");
-            WRITE_NODE(node->value.subtraction.b);
-            break;
-        case MULTIPLICATION_NODE:
-            WRITE_NODE(node->value.multiplication.a);
-            WRITE(" * ");
-            WRITE_NODE(node->value.multiplication.b);
-            break;
-        case DIVISION_NODE:
-            WRITE_NODE(node->value.division.a);
-            WRITE(" / ");
-            WRITE_NODE(node->value.division.b);
-            break;
-        case REMAINDER_NODE:
-            WRITE_NODE(node->value.remainder.a);
-            WRITE(" % ");
-            WRITE_NODE(node->value.remainder.b);
-            break;
-        case NEGATION_NODE:
-            WRITE_C('-');
-            WRITE_NODE(node->value.negation.x);
-            break;
-        case BITWISE_AND_NODE:
-            WRITE_NODE(node->value.bitwise_and.a);
-            WRITE(" & ");
-            WRITE_NODE(node->value.bitwise_and.b);
-            break;
-        case BITWISE_OR_NODE:
-            WRITE_NODE(node->value.bitwise_or.a);
-            WRITE(" | ");
-            WRITE_NODE(node->value.bitwise_or.b);
-            break;
-        case BITWISE_XOR_NODE:
-            WRITE_NODE(node->value.bitwise_xor.a);
-            WRITE(" ^ ");
-            WRITE_NODE(node->value.bitwise_xor.b);
-            break;
-        case LEFT_SHIFT_NODE:
-            WRITE_NODE(node->value.left_shift.x);
-            WRITE(" << ");
-            WRITE_NODE(node->value.left_shift.n);
-            break;
-        case RIGHT_SHIFT_NODE:
-            WRITE_NODE(node->value.right_shift.x);
-            WRITE(" >> ");
-            WRITE_NODE(node->value.right_shift.n);
-            break;
-        case BITWISE_NOT_NODE:
-            WRITE_C('~');
-            WRITE_NODE(node->value.bitwise_not.x);
-            break;
-        case LOGICAL_AND_NODE:
-            WRITE_NODE(node->value.logical_and.a);
-            WRITE(" && ");
-            WRITE_NODE(node->value.logical_and.b);
-            break;
-        case LOGICAL_OR_NODE:
-            WRITE_NODE(node->value.logical_or.a);
-            WRITE(" || ");
-            WRITE_NODE(node->value.logical_or.b);
-            break;
-        case LOGICAL_NOT_NODE:
-            WRITE_C('!');
-            WRITE_NODE(node->value.logical_not.x);
-            break;
-        case EQUALS_NODE:
-            WRITE_NODE(node->value.equals.a);
-            WRITE(" == ");
-            WRITE_NODE(node->value.equals.b);
-            break;
-        case NOT_EQUALS_NODE:
-            WRITE_NODE(node->value.not_equals.a);
-            WRITE(" != ");
-            WRITE_NODE(node->value.not_equals.b);
-            break;
-        case LESS_THAN_NODE:
-            WRITE_NODE(node->value.less_than.a);
-            WRITE(" < ");
-            WRITE_NODE(node->value.less_than.b);
-            break;
-        case GREATER_THAN_NODE:
-            WRITE_NODE(node->value.greater_than.a);
-            WRITE(" > ");
-            WRITE_NODE(node->value.greater_than.b);
-            break;
-        case LESS_THAN_EQUAL_NODE:
-            WRITE_NODE(node->value.less_than_equal.a);
-            WRITE(" < ");
-            WRITE_NODE(node->value.less_than_equal.b);
-            break;
-        case GREATER_THAN_EQUAL_NODE:
-            WRITE_NODE(node->value.greater_than_equal.a);
-            WRITE(" > ");
-            WRITE_NODE(node->value.greater_than_equal.b);
-            break;
-        case DEREF_NODE:
-            WRITE_C('*');
-            WRITE_NODE(node->value.deref.x);
+        case IR_VALUE_STRING:
+            if(v->data_type->type == SLICE_TYPE_NODE) {
+                WRITE("((");
+                WRITE_TYPE(v->data_type);
+                WRITE(") { .data = (uint8_t*) ");
+                WRITE_S(v->value.literal);
+                WRITE(", .length = sizeof(");
+                WRITE_S(v->value.literal);
+                WRITE(") - 1 })");
+                break;
+            }
+            WRITE("((");
+            WRITE_TYPE(v->data_type);
+            WRITE(") ");
+            WRITE_S(v->value.literal);
+            WRITE_C(')');
             break;
-        case ADDRESS_OF_NODE:
-            WRITE_C('&');
-            WRITE_NODE(node->value.address_of.x);
+        case IR_VALUE_BOOLEAN:
+            WRITE_S(v->value.literal);
             break;
-        case SIZE_OF_NODE:
+        case IR_VALUE_SIZE_OF:
             WRITE("sizeof(");
-            WRITE_TYPE(node->value.size_of.t);
+            WRITE_TYPE(v->value.size_of);
             WRITE_C(')');
             break;
-        case MEMBER_ACCESS_NODE:
-            WRITE_NODE(node->value.member_access.x);
-            WRITE_C('.');
-            WRITE_S(node->value.member_access.name);
-            break;
-        case NAMESPACE_ACCESS_NODE:
-            emit_path(
-                &node->value.namespace_access.path,
-                node->value.namespace_access.variant,
-                out
-            );
-            Symbol* accessed = s_table_lookup(
-                symbols, node->value.namespace_access.path
-            );
-            if(accessed != NULL && (
-                accessed->node.type == EXTERNAL_FUNCTION_NODE
-                    || accessed->node.type == FUNCTION_NODE
-            )) {
-                WRITE("()");
-            }
+    }
+}
+
+static void emit_place(
+    IrFunction* f, IrPlace* p, SymbolTable* symbols,
+    StringBuilder* typesdefs, ArrayBuilder(RecordEntry)* types,
+    StringBuilder* out
+) {
+    switch(p->type) {
+        case IR_PLACE_LOCAL:
+            emit_local(f, p->base.local, out);
             break;
-        case TYPE_CONVERSION_NODE:
-            WRITE_C('(');
-            WRITE_TYPE(node->value.type_conversion.to);
-            WRITE(") ");
-            WRITE_NODE(node->value.type_conversion.x);
+        case IR_PLACE_DEREF:
+            WRITE("(*");
+            WRITE_VALUE(&p->base.pointer);
+            WRITE_C(')');
             break;
-        case RETURN_VALUE_NODE:
-            WRITE("return");
-            if(node->value.return_value.has_value) {
-                WRITE_C(' ');
-                WRITE_NODE(node->value.return_value.value);
-            }
+        case IR_PLACE_CONSTANT:
+            emit_path(&p->base.constant, 0, out);
             break;
-        case IF_ELSE_NODE:
-            WRITE("if(");
-            WRITE_NODE(node->value.if_else.condition);
-            WRITE(") { ");
-            emit_block(
-                node->value.if_else.if_body, symbols, typesdefs, types, out
-            );
-            WRITE(" } else { ");
-            emit_block(
-                node->value.if_else.else_body, symbols, typesdefs, types, out
-            );
-            WRITE(" }");
+        case IR_PLACE_GLOBAL:
+            emit_path(&p->base.global, 0, out);
             break;
-        case WHILE_DO_NODE:
-            WRITE("while(");
-            WRITE_NODE(node->value.while_do.condition);
-            WRITE(") { ");
-            emit_block(
-                node->value.while_do.body, symbols, typesdefs, types, out
+    }
+    for(size_t pi = 0; pi < p->projectionc; pi += 1) {
+        IrProjection* projection = p->projectionv + pi;
+        switch(projection->type) {
+            case IR_PROJECTION_MEMBER:
+                WRITE_C('.');
+                WRITE_S(projection->member);
+                break;
+            case IR_PROJECTION_INDEX:
+            case IR_PROJECTION_SLICE_INDEX:
+                WRITE(".data[");
+                WRITE_VALUE(&projection->index);
+                WRITE_C(']');
+                break;
+            case IR_PROJECTION_LANE:
+                WRITE_C('[');
+                WRITE_VALUE(&projection->index);
+                WRITE_C(']');
+                break;
+        }
+    }
+}
+
+static const char* operator_string(NodeType op) {
+    switch(op) {
+        case ADDITION_NODE: return "+";
+        case SUBTRACTION_NODE: return "-";
+        case MULTIPLICATION_NODE: return "*";
+        case DIVISION_NODE: return "/";
+        case REMAINDER_NODE: return "%";
+        case NEGATION_NODE: return "-";
+        case BITWISE_AND_NODE: return "&";
+        case BITWISE_OR_NODE: return "|";
+        case BITWISE_XOR_NODE: return "^";
+        case LEFT_SHIFT_NODE: return "<<";
+        case RIGHT_SHIFT_NODE: return ">>";
+        case BITWISE_NOT_NODE: return "~";
+        case LOGICAL_NOT_NODE: return "!";
+        case EQUALS_NODE: return "==";
+        case NOT_EQUALS_NODE: return "!=";
+        case LESS_THAN_NODE: return "<";
+        case GREATER_THAN_NODE: return ">";
+        case LESS_THAN_EQUAL_NODE: return "<=";
+        case GREATER_THAN_EQUAL_NODE: return ">=";
+    }
+    panic("UNHANDLED OPERATOR!");
+}
+
+// passes the value of an argument through a pointer, to a copy if the
+// callee could otherwise see changes made through other pointers
+static void emit_argument_pointer(
+    IrFunction* f, IrValue* v, SymbolTable* symbols,
+    StringBuilder* typesdefs, ArrayBuilder(RecordEntry)* types,
+    StringBuilder* out
+) {
+    if(v->type == IR_VALUE_LOCAL
+        && !f->locals[v->value.local].is_address_taken) {
+        WRITE_C('&');
+        WRITE_VALUE(v);
+        return;
+    }
+    WRITE_C('(');
+    WRITE_TYPE(v->data_type);
+    WRITE("[]) { ");
+    WRITE_VALUE(v);
+    WRITE(" }");
+}
+
+static bool is_suspension(IrInstruction* i) {
+    return i->type == IR_AWAIT || i->type == IR_YIELD;
+}
+
+// the struct holding the state, the returned value, the locals and the
+// frames of the awaited functions of an async function, which is declared
+// after the frames it contains (identified by the path of the function)
+static void declare_frame(
+    IrFunction* f, IrProgram* program, size_t depth, SymbolTable* symbols,
+    StringBuilder* typesdefs, ArrayBuilder(RecordEntry)* types
+) {
+    for(size_t typei = 0; typei < types->length; typei += 1) {
+        RecordEntry* entry = ((RecordEntry*) types->buffer) + typei;
+        if(entry->is_structural) { continue; }
+        if(namespace_eq(f->path, entry->path) && f->variant == entry->variant) {
+            return;
+        }
+    }
+    if(depth > program->function_count) {
+        panic("Async functions can not await themselves!");
+    }
+    size_t awaitc = 0;
+    for(size_t blocki = 0; blocki < f->block_count; blocki += 1) {
+        IrBlock* block = f->blocks + blocki;
+        for(size_t ii = 0; ii < block->instruction_count; ii += 1) {
+            if(block->instructions[ii].type == IR_AWAIT) { awaitc += 1; }
+        }
+    }
+    // each awaited function has one frame, as they never run at once
+    IrFunction* awaitedv[awaitc + 1];
+    size_t awaitedc = 0;
+    for(size_t blocki = 0; blocki < f->block_count; blocki += 1) {
+        IrBlock* block = f->blocks + blocki;
+        for(size_t ii = 0; ii < block->instruction_count; ii += 1) {
+            IrInstruction* i = block->instructions + ii;
+            if(i->type != IR_AWAIT) { continue; }
+            IrFunction* awaited = ir_program_lookup(
+                program, i->value.coroutine.path, i->value.coroutine.variant
             );
-            WRITE(" }");
-            break;
-        case CALL_NODE:
-            #define WRITE_ARGS() \
-                WRITE_C('('); \
-                for(size_t argi = 0; argi < node->value.call.argc; argi += 1) { \
-                    if(argi > 0) { WRITE(", "); } \
-                    WRITE_NODE(node->value.call.argv + argi); \
-                } \
-                WRITE_C(')');
-            if(node->value.call.called->type == NAMESPACE_ACCESS_NODE) {
-                Namespace called_path = node->value.call.called
-                    ->value.namespace_access.path;
-                size_t called_variant = node->value.call.called
-                    ->value.namespace_access.variant;
-                Symbol* called = s_table_lookup(symbols, called_path);
-                if(called == NULL) {
-                    WRITE("/* COULD NOT BE FOUND: '");
-                    emit_path(&called_path, called_variant, out);
-                    WRITE("' */");
-                    return;
-                }
-                switch(called->node.type) {
-                    case FUNCTION_NODE:
-                        emit_path(&called_path, called_variant, out);
-                        WRITE_ARGS();
-                        break;
-                    case EXTERNAL_FUNCTION_NODE:
-                        WRITE_S(
-                            called->node.value.external_function.external_name
-                        );
-                        WRITE_ARGS();
-                        break;
-                    case RECORD_NODE:
-                        WRITE_C('(');
-                        emit_path(&called_path, called_variant, out);
-                        WRITE(") { ");
-                        size_t memberc = called->node.value.record.argc;
-                        String* membernamev = called->node.value.record.argnamev;
-                        for(size_t argi = 0; argi < memberc; argi += 1) {
-                            if(argi > 0) { WRITE(", "); }
-                            WRITE_C('.');
-                            WRITE_S(membernamev[argi]);
-                            WRITE(" = ");
-                            WRITE_NODE(node->value.call.argv + argi);
-                        }
-                        WRITE(" }");
-                        break;
-                }
-            } else {
-                WRITE_NODE(node->value.call.called);
-                WRITE_ARGS();
+            bool is_known = false;
+            for(size_t ai = 0; ai < awaitedc; ai += 1) {
+                if(awaitedv[ai] == awaited) { is_known = true; }
             }
-            break;
+            if(is_known) { continue; }
+            declare_frame(
+                awaited, program, depth + 1, symbols, typesdefs, types
+            );
+            awaitedv[awaitedc] = awaited;
+            awaitedc += 1;
+        }
+    }
+    StringBuilder decl = stringbuilder_new();
+    StringBuilder* out = &decl;
+    WRITE("typedef struct ");
+    emit_path(&f->path, f->variant, out);
+    WRITE("_frame { uint32_t _state; ");
+    if(!ir_type_is_unit(f->return_type)) {
+        WRITE_TYPE(f->return_type);
+        WRITE(" _result; ");
+    }
+    for(size_t locali = 0; locali < f->local_count; locali += 1) {
+        if(!f->locals[locali].is_in_frame) { continue; }
+        WRITE_TYPE(f->locals[locali].type);
+        WRITE_C(' ');
+        emit_local_name(f, locali, out);
+        WRITE("; ");
     }
+    if(awaitedc > 0) {
+        WRITE("union { ");
+        for(size_t ai = 0; ai < awaitedc; ai += 1) {
+            emit_path(&awaitedv[ai]->path, awaitedv[ai]->variant, out);
+            WRITE("_frame ");
+            emit_path(&awaitedv[ai]->path, awaitedv[ai]->variant, out);
+            WRITE("; ");
+        }
+        WRITE("} _awaiting; ");
+    }
+    WRITE("} ");
+    emit_path(&f->path, f->variant, out);
+    WRITE("_frame;\n");
+    stringbuilder_push(typesdefs, decl.length, decl.buffer);
+    stringbuilder_free(&decl);
+    arraybuilder_push(RecordEntry)(types, (RecordEntry) {
+        .path = f->path, .variant = f->variant, .is_structural = false
+    });
+}
+
+// 'frame->_awaiting.<path of the awaited function>'
+static void emit_awaited_frame(IrFunction* awaited, StringBuilder* out) {
+    WRITE("frame->_awaiting.");
+    emit_path(&awaited->path, awaited->variant, out);
 }
 
-static void emit_block(
-    Block block, SymbolTable* symbols, 
+// saves the state to continue from at the label of the suspension point,
+// where an await runs the frame of the awaited function until it returns
+static void emit_suspension(
+    IrFunction* f, IrInstruction* i, size_t suspension, IrProgram* program,
+    SymbolTable* symbols,
     StringBuilder* typesdefs, ArrayBuilder(RecordEntry)* types,
     StringBuilder* out
 ) {
-    for(size_t si = 0; si < block.length; si += 1) {
-        if(si > 0) { WRITE_C(' '); }
-        emit_node(block.statements + si, symbols, typesdefs, types, out);
-        WRITE_C(';');
+    if(i->type == IR_YIELD) {
+        WRITE("    frame->_state = ");
+        emit_size(suspension, out);
+        WRITE(";\n    return false;\nresume");
+        emit_size(suspension, out);
+        WRITE(": ;\n");
+        return;
+    }
+    IrFunction* awaited = ir_program_lookup(
+        program, i->value.coroutine.path, i->value.coroutine.variant
+    );
+    // the other members of the frame are written before being read
+    for(size_t argi = 0; argi < i->value.coroutine.argc; argi += 1) {
+        WRITE("    ");
+        emit_awaited_frame(awaited, out);
+        WRITE_C('.');
+        emit_local_name(awaited, argi, out);
+        WRITE(" = ");
+        WRITE_VALUE(i->value.coroutine.argv + argi);
+        WRITE(";\n");
+    }
+    WRITE("    ");
+    emit_awaited_frame(awaited, out);
+    WRITE("._state = 0;\nresume");
+    emit_size(suspension, out);
+    WRITE(":\n    if(!");
+    emit_path(&awaited->path, awaited->variant, out);
+    WRITE("_resume(&");
+    emit_awaited_frame(awaited, out);
+    WRITE(")) {\n        frame->_state = ");
+    emit_size(suspension, out);
+    WRITE(";\n        return false;\n    }\n");
+    if(i->has_dest) {
+        WRITE("    ");
+        emit_local(f, i->dest, out);
+        WRITE(" = ");
+        emit_awaited_frame(awaited, out);
+        WRITE("._result;\n");
     }
 }
 
-static void emit_symbol_variant_pre(
-    Node* symbol, size_t variant, SymbolTable* symbols,
+static void emit_instruction(
+    IrFunction* f, IrInstruction* i, size_t* suspension, IrProgram* program,
+    SymbolTable* symbols,
     StringBuilder* typesdefs, ArrayBuilder(RecordEntry)* types,
     StringBuilder* out
 ) {
-    switch(symbol->type) {
-        case RECORD_NODE:
-            WRITE("typedef struct ");
-            emit_path(&symbol->value.record.path, variant, out);
+    if(is_suspension(i)) {
+        *suspension += 1;
+        emit_suspension(
+            f, i, *suspension, program, symbols, typesdefs, types, out
+        );
+        return;
+    }
+    IrFunction* called = i->type != IR_CALL || i->value.call.is_external
+        ? NULL
+        : ir_program_lookup(
+            program, i->value.call.path, i->value.call.variant
+        );
+    // the callee writes the returned value to the destination itself
+    bool returns_by_pointer = called != NULL && called->returns_by_pointer;
+    WRITE("    ");
+    if(i->has_dest && !returns_by_pointer) {
+        emit_local(f, i->dest, out);
+        WRITE(" = ");
+    }
+    switch(i->type) {
+        case IR_UNARY:
+            WRITE(operator_string(i->value.unary.op));
+            WRITE_VALUE(&i->value.unary.x);
+            break;
+        case IR_BINARY:
+            WRITE_VALUE(&i->value.binary.a);
+            WRITE_C(' ');
+            WRITE(operator_string(i->value.binary.op));
+            WRITE_C(' ');
+            WRITE_VALUE(&i->value.binary.b);
+            break;
+        case IR_CONVERT:
+            WRITE_C('(');
+            if(i->has_dest) {
+                emit_local_type(f, i->dest, symbols, typesdefs, types, out);
+            } else {
+                WRITE_TYPE(i->value.convert.to);
+            }
+            WRITE(") ");
+            WRITE_VALUE(&i->value.convert.x);
+            break;
+        case IR_LOAD:
+            WRITE_PLACE(&i->value.load.from);
+            break;
+        case IR_STORE:
+            WRITE_PLACE(&i->value.store.to);
+            WRITE(" = ");
+            WRITE_VALUE(&i->value.store.value);
+            break;
+        case IR_ADDRESS_OF:
+            WRITE_C('&');
+            WRITE_PLACE(&i->value.address_of.of);
+            break;
+        case IR_CALL:
+            if(i->value.call.is_external) {
+                WRITE_S(i->value.call.external_name);
+            } else {
+                emit_path(&i->value.call.path, i->value.call.variant, out);
+            }
+            WRITE_C('(');
+            for(size_t argi = 0; argi < i->value.call.argc; argi += 1) {
+                if(argi > 0) { WRITE(", "); }
+                if(called != NULL && called->locals[argi].is_by_pointer) {
+                    emit_argument_pointer(
+                        f, i->value.call.argv + argi, symbols, typesdefs,
+                        types, out
+                    );
+                } else {
+                    WRITE_VALUE(i->value.call.argv + argi);
+                }
+            }
+            if(returns_by_pointer) {
+                if(i->value.call.argc > 0) { WRITE(", "); }
+                if(i->has_dest) {
+                    WRITE_C('&');
+                    emit_local(f, i->dest, out);
+                } else {
+                    WRITE("&(");
+                    WRITE_TYPE(called->return_type);
+                    WRITE(") { 0 }");
+                }
+            }
+            WRITE_C(')');
+            break;
+        case IR_RECORD:
+            WRITE_C('(');
+            WRITE_TYPE(i->value.record.type);
+            WRITE(") { ");
+            for(size_t argi = 0; argi < i->value.record.argc; argi += 1) {
+                if(argi > 0) { WRITE(", "); }
+                WRITE_C('.');
+                WRITE_S(i->value.record.argnamev[argi]);
+                WRITE(" = ");
+                WRITE_VALUE(i->value.record.argv + argi);
+            }
+            WRITE(" }");
+            break;
+        case IR_ARRAY:
+            WRITE_C('(');
+            WRITE_TYPE(i->value.array.type);
+            if(i->value.array.valuec == 0) {
+                WRITE(") { 0 }");
+                break;
+            }
+            bool is_vector = ir_type_is_vector(i->value.array.type);
+            WRITE(is_vector? ") { " : ") { .data = { ");
+            for(size_t vi = 0; vi < i->value.array.valuec; vi += 1) {
+                if(vi > 0) { WRITE(", "); }
+                WRITE_VALUE(i->value.array.valuev + vi);
+            }
+            WRITE(is_vector? " }" : " } }");
+            break;
+        case IR_SLICE:
+            WRITE_C('(');
+            WRITE_TYPE(i->value.slice.type);
+            WRITE(") { .data = ");
+            WRITE_VALUE(&i->value.slice.data);
+            WRITE(" + ");
+            WRITE_VALUE(&i->value.slice.start);
+            WRITE(", .length = ");
+            WRITE_VALUE(&i->value.slice.end);
+            WRITE(" - ");
+            WRITE_VALUE(&i->value.slice.start);
+            WRITE(" }");
+            break;
+        case IR_PARALLEL: {
+            Namespace* path = &i->value.parallel.path;
+            size_t variant = i->value.parallel.variant;
+            WRITE("nino_parallel_for(&");
+            emit_path(path, variant, out);
+            WRITE("_chunk, ");
+            if(i->value.parallel.capturec == 0) {
+                WRITE("NULL");
+            } else {
+                WRITE("&(");
+                emit_path(path, variant, out);
+                WRITE("_context) { ");
+                size_t capturec = i->value.parallel.capturec;
+                for(size_t ci = 0; ci < capturec; ci += 1) {
+                    if(ci > 0) { WRITE(", "); }
+                    WRITE_VALUE(i->value.parallel.capturev + ci);
+                }
+                WRITE(" }");
+            }
+            WRITE(", ");
+            WRITE_VALUE(&i->value.parallel.start);
+            WRITE(", ");
+            WRITE_VALUE(&i->value.parallel.end);
+            WRITE_C(')');
+            break;
+        }
+        case IR_TASK: {
+            IrFunction* started = ir_program_lookup(
+                program, i->value.coroutine.path, i->value.coroutine.variant
+            );
+            declare_frame(started, program, 0, symbols, typesdefs, types);
+            WRITE("nino_task_new(&");
+            emit_path(&started->path, started->variant, out);
+            WRITE("_resume, &(");
+            emit_path(&started->path, started->variant, out);
+            WRITE("_frame) { ._state = 0");
+            for(size_t argi = 0; argi < i->value.coroutine.argc; argi += 1) {
+                WRITE(", .");
+                emit_local_name(started, argi, out);
+                WRITE(" = ");
+                WRITE_VALUE(i->value.coroutine.argv + argi);
+            }
+            WRITE(" }, sizeof(");
+            emit_path(&started->path, started->variant, out);
+            WRITE("_frame))");
+            break;
+        }
+        case IR_AWAIT:
+        case IR_YIELD:
+            panic("UNHANDLED SUSPENSION POINT!");
+    }
+    WRITE(";\n");
+}
+
+static void emit_block_label(size_t block, StringBuilder* out) {
+    WRITE_C('b');
+    emit_size(block, out);
+}
+
+static bool loop_contains(IrLoop* loop, size_t block) {
+    return block >= loop->header && block < loop->end;
+}
+
+// the innermost loop containing the block, NULL if there is none
+static IrLoop* innermost_loop(IrFunction* f, size_t block) {
+    for(size_t loopi = 0; loopi < f->loop_count; loopi += 1) {
+        if(loop_contains(f->loops + loopi, block)) { return f->loops + loopi; }
+    }
+    return NULL;
+}
+
+// a branch leaving a loop with 'likely_trip N' stays in the loop with a
+// probability of 1 - 1/N
+static void emit_branch_condition(
+    IrFunction* f, IrTerminator* t, IrLoop* loop, SymbolTable* symbols,
+    StringBuilder* typesdefs, ArrayBuilder(RecordEntry)* types,
+    StringBuilder* out
+) {
+    Attribute* trip = loop == NULL? NULL
+        : attributes_find(&loop->attributes, "likely_trip");
+    bool stays_true = trip != NULL
+        && loop_contains(loop, t->value.branch.if_true);
+    bool stays_false = trip != NULL
+        && loop_contains(loop, t->value.branch.if_false);
+    if(stays_true == stays_false) {
+        WRITE_VALUE(&t->value.branch.condition);
+        return;
+    }
+    WRITE("__builtin_expect_with_probability(");
+    WRITE_VALUE(&t->value.branch.condition);
+    WRITE(stays_true? ", 1, 1.0 - 1.0 / " : ", 0, 1.0 - 1.0 / ");
+    WRITE_S(trip->value);
+    WRITE_C(')');
+}
+
+static void emit_case_value(
+    uint64_t value, bool is_signed, StringBuilder* out
+) {
+    char digits[32];
+    if(is_signed && (int64_t) value == INT64_MIN) {
+        WRITE("INT64_MIN");
+        return;
+    }
+    if(is_signed) { sprintf(digits, "%lld", (long long) (int64_t) value); }
+    else { sprintf(digits, "%lluu", (unsigned long long) value); }
+    WRITE(digits);
+}
+
+// returns whether anything has been written
+static bool emit_terminator(
+    IrFunction* f, IrTerminator* t, size_t next, IrLoop* loop,
+    SymbolTable* symbols,
+    StringBuilder* typesdefs, ArrayBuilder(RecordEntry)* types,
+    StringBuilder* out
+) {
+    switch(t->type) {
+        case IR_JUMP:
+            if(t->value.jump.to == next) { return false; }
+            WRITE("    goto ");
+            emit_block_label(t->value.jump.to, out);
+            WRITE(";\n");
+            return true;
+        case IR_BRANCH:
+            WRITE("    if(");
+            if(t->value.branch.if_true == next) {
+                WRITE_C('!');
+                emit_branch_condition(
+                    f, t, loop, symbols, typesdefs, types, out
+                );
+                WRITE(") goto ");
+                emit_block_label(t->value.branch.if_false, out);
+                WRITE(";\n");
+                return true;
+            }
+            emit_branch_condition(f, t, loop, symbols, typesdefs, types, out);
+            WRITE(") goto ");
+            emit_block_label(t->value.branch.if_true, out);
+            WRITE(";\n");
+            if(t->value.branch.if_false != next) {
+                WRITE("    goto ");
+                emit_block_label(t->value.branch.if_false, out);
+                WRITE(";\n");
+            }
+            return true;
+        case IR_SWITCH: {
+            Node* type = t->value.switch_on.value.data_type;
+            bool is_signed = ir_type_is_integer(type) && string_char_at(
+                type->value.namespace_access.path.elements[0], 0
+            ) == 's';
+            WRITE("    switch(");
+            // switching on a boolean is warned about
+            if(ir_type_is_core(type, "bool")) { WRITE("(int) "); }
+            WRITE_VALUE(&t->value.switch_on.value);
+            WRITE(") {\n");
+            for(size_t ci = 0; ci < t->value.switch_on.casec; ci += 1) {
+                IrSwitchCase* c = t->value.switch_on.casev + ci;
+                WRITE("        case ");
+                emit_case_value(c->low, is_signed, out);
+                if(c->high != c->low) {
+                    WRITE(" ... ");
+                    emit_case_value(c->high, is_signed, out);
+                }
+                WRITE(": goto ");
+                emit_block_label(c->to, out);
+                WRITE(";\n");
+            }
+            WRITE("        default: goto ");
+            emit_block_label(t->value.switch_on.otherwise, out);
+            WRITE(";\n    }\n");
+            return true;
+        }
+        case IR_RETURN:
+            if(f->is_async) {
+                if(t->value.return_value.has_value) {
+                    WRITE("    frame->_result = ");
+                    WRITE_VALUE(&t->value.return_value.value);
+                    WRITE(";\n");
+                }
+                WRITE("    frame->_state = UINT32_MAX;\n    return true;\n");
+                return true;
+            }
+            if(f->returns_by_pointer) {
+                WRITE("    *_out = ");
+                WRITE_VALUE(&t->value.return_value.value);
+                WRITE(";\n    return;\n");
+                return true;
+            }
+            WRITE("    return");
+            if(t->value.return_value.has_value) {
+                WRITE_C(' ');
+                WRITE_VALUE(&t->value.return_value.value);
+            }
+            WRITE(";\n");
+            return true;
+        case IR_UNREACHABLE:
+            WRITE("    __builtin_unreachable();\n");
+            return true;
+        case IR_TRAP:
+            WRITE("    __builtin_trap();\n");
+            return true;
+    }
+    return false;
+}
+
+static void mark_reachable(IrFunction* f, size_t block, bool* reachable) {
+    if(reachable[block]) { return; }
+    reachable[block] = true;
+    IrTerminator* t = &f->blocks[block].terminator;
+    switch(t->type) {
+        case IR_JUMP:
+            mark_reachable(f, t->value.jump.to, reachable);
+            break;
+        case IR_BRANCH:
+            mark_reachable(f, t->value.branch.if_true, reachable);
+            mark_reachable(f, t->value.branch.if_false, reachable);
+            break;
+        case IR_SWITCH:
+            for(size_t ci = 0; ci < t->value.switch_on.casec; ci += 1) {
+                mark_reachable(f, t->value.switch_on.casev[ci].to, reachable);
+            }
+            mark_reachable(f, t->value.switch_on.otherwise, reachable);
+            break;
+    }
+}
+
+static size_t next_reachable(IrFunction* f, size_t block, bool* reachable) {
+    for(size_t next = block + 1; next < f->block_count; next += 1) {
+        if(reachable[next]) { return next; }
+    }
+    return f->block_count;
+}
+
+// loops with hints are emitted as 'while(1) { ... }' after the pragmas,
+// since the pragmas only apply to loop statements
+static bool is_emitted_loop(IrLoop* loop, bool* reachable) {
+    return loop->attributes.length > 0 && reachable[loop->header];
+}
+
+// the block that is executed after the end of 'block', which is the header
+// of a loop if 'block' is the last block inside of it
+static size_t fallthrough_of(IrFunction* f, size_t block, bool* reachable) {
+    size_t next = next_reachable(f, block, reachable);
+    // inner loops come first
+    for(size_t loopi = 0; loopi < f->loop_count; loopi += 1) {
+        IrLoop* loop = f->loops + loopi;
+        if(!is_emitted_loop(loop, reachable)) { continue; }
+        if(loop_contains(loop, block) && !loop_contains(loop, next)) {
+            return loop->header;
+        }
+    }
+    return next;
+}
+
+static void emit_loop_pragmas(IrLoop* loop, StringBuilder* out) {
+    Attribute* unroll = attributes_find(&loop->attributes, "unroll");
+    bool vectorize = attributes_find(&loop->attributes, "vectorize") != NULL;
+    bool ivdep = attributes_find(&loop->attributes, "ivdep") != NULL
+        || attributes_find(&loop->attributes, "no_alias") != NULL;
+    if(unroll == NULL && !vectorize && !ivdep) { return; }
+    WRITE("#if defined(__clang__)\n#pragma clang loop");
+    if(unroll != NULL) {
+        WRITE(" unroll_count(");
+        WRITE_S(unroll->value);
+        WRITE_C(')');
+    }
+    if(ivdep) { WRITE(" vectorize(assume_safety)"); }
+    else if(vectorize) { WRITE(" vectorize(enable)"); }
+    WRITE_C('\n');
+    // GCC has no pragma to only enable vectorization of a loop
+    if(unroll != NULL || ivdep) { WRITE("#else\n"); }
+    if(unroll != NULL) {
+        WRITE("#pragma GCC unroll ");
+        WRITE_S(unroll->value);
+        WRITE_C('\n');
+    }
+    if(ivdep) { WRITE("#pragma GCC ivdep\n"); }
+    WRITE("#endif\n");
+}
+
+static void mark_value_used(IrValue* v, void* data) {
+    bool* used = (bool*) data;
+    if(v->type == IR_VALUE_LOCAL) { used[v->value.local] = true; }
+}
+
+static void mark_place_used(IrPlace* p, void* data) {
+    bool* used = (bool*) data;
+    if(p->type == IR_PLACE_LOCAL) { used[p->base.local] = true; }
+}
+
+// the hints given with 'with inline fun ...', where inlined functions are
+// static since an inline definition in C needs another external one
+static void emit_function_attributes(Attributes* a, StringBuilder* out) {
+    const char* attributes[] = {
+        "inline", "static inline __attribute__((always_inline)) ",
+        "noinline", "__attribute__((noinline)) ",
+        "hot", "__attribute__((hot)) ",
+        "cold", "__attribute__((cold)) ",
+        "flatten", "__attribute__((flatten)) ",
+        NULL
+    };
+    for(size_t ai = 0; attributes[ai] != NULL; ai += 2) {
+        if(attributes_find(a, attributes[ai]) != NULL) {
+            WRITE(attributes[ai + 1]);
+        }
+    }
+}
+
+// the struct holding the values captured by the body of a 'par' loop
+static void declare_parallel_context(
+    IrFunction* f, size_t capturec, SymbolTable* symbols,
+    StringBuilder* typesdefs, ArrayBuilder(RecordEntry)* types
+) {
+    StringBuilder decl = stringbuilder_new();
+    StringBuilder* out = &decl;
+    WRITE("typedef struct ");
+    emit_path(&f->path, f->variant, out);
+    WRITE("_context { ");
+    for(size_t argi = 0; argi < capturec; argi += 1) {
+        WRITE_TYPE(f->locals[argi].type);
+        WRITE_C(' ');
+        emit_local_name(f, argi, out);
+        WRITE("; ");
+    }
+    WRITE("} ");
+    emit_path(&f->path, f->variant, out);
+    WRITE("_context;\n");
+    stringbuilder_push(typesdefs, decl.length, decl.buffer);
+    stringbuilder_free(&decl);
+}
+
+// the function the runtime calls with parts of the indices of a 'par' loop,
+// which gets the captured values from the struct
+static void emit_parallel_entry(
+    IrFunction* f, SymbolTable* symbols,
+    StringBuilder* typesdefs, ArrayBuilder(RecordEntry)* types,
+    StringBuilder* out
+) {
+    // the arguments end with the index and the end of the indices
+    size_t capturec = f->argc - 2;
+    if(capturec > 0) {
+        declare_parallel_context(f, capturec, symbols, typesdefs, types);
+    }
+    WRITE("static void ");
+    emit_path(&f->path, f->variant, out);
+    WRITE("_chunk(void* context, size_t start, size_t end) {\n");
+    if(capturec == 0) {
+        WRITE("    (void) context;\n");
+    } else {
+        WRITE("    ");
+        emit_path(&f->path, f->variant, out);
+        WRITE("_context* c = (");
+        emit_path(&f->path, f->variant, out);
+        WRITE("_context*) context;\n");
+    }
+    WRITE("    ");
+    emit_path(&f->path, f->variant, out);
+    WRITE_C('(');
+    for(size_t argi = 0; argi < capturec; argi += 1) {
+        if(f->locals[argi].is_by_pointer) { WRITE_C('&'); }
+        WRITE("c->");
+        emit_local_name(f, argi, out);
+        WRITE(", ");
+    }
+    WRITE("start, end);\n");
+    WRITE("}\n");
+}
+
+static void emit_ir_function(
+    IrFunction* f, IrProgram* program, SymbolTable* symbols,
+    StringBuilder* typesdefs, ArrayBuilder(RecordEntry)* types,
+    StringBuilder* out
+) {
+    if(f->is_async) {
+        // continues the frame from the suspension point in its state,
+        // returning whether the function has returned
+        declare_frame(f, program, 0, symbols, typesdefs, types);
+        WRITE("static bool ");
+        emit_path(&f->path, f->variant, out);
+        WRITE("_resume(void* context) {\n    ");
+        emit_path(&f->path, f->variant, out);
+        WRITE("_frame* frame = (");
+        emit_path(&f->path, f->variant, out);
+        WRITE("_frame*) context;\n");
+    } else {
+        // the bodies of 'par' loops are written before the functions using
+        // them and have no symbol
+        if(f->is_parallel_body) {
+            WRITE("static ");
+        } else {
+            Node* function = s_table_lookup(symbols, f->path)->variants
+                + f->variant;
+            emit_function_attributes(
+                &function->value.function.attributes, out
+            );
+        }
+        emit_return_type(
+            f, f->return_type, symbols, typesdefs, types, out
+        );
+        WRITE_C(' ');
+        emit_path(&f->path, f->variant, out);
+        WRITE_C('(');
+        for(size_t argi = 0; argi < f->argc; argi += 1) {
+            if(argi > 0) { WRITE(", "); }
+            bool is_by_pointer = f->locals[argi].is_by_pointer;
+            if(is_by_pointer) { WRITE("const "); }
+            emit_local_type(f, argi, symbols, typesdefs, types, out);
+            WRITE(is_by_pointer? "* " : " ");
+            emit_local_name(f, argi, out);
+        }
+        if(f->returns_by_pointer) {
+            if(f->argc > 0) { WRITE(", "); }
+            WRITE_TYPE(f->return_type);
+            WRITE("* _out");
+        }
+        WRITE(") {\n");
+    }
+    // optimizations may leave locals that are no longer referenced
+    bool used[f->local_count + 1];
+    for(size_t locali = 0; locali < f->local_count; locali += 1) {
+        used[locali] = false;
+    }
+    IrVisitor mark_used = (IrVisitor) {
+        .visit_value = &mark_value_used, .visit_place = &mark_place_used,
+        .data = used
+    };
+    for(size_t blocki = 0; blocki < f->block_count; blocki += 1) {
+        IrBlock* block = f->blocks + blocki;
+        for(size_t ii = 0; ii < block->instruction_count; ii += 1) {
+            IrInstruction* i = block->instructions + ii;
+            if(i->has_dest) { used[i->dest] = true; }
+            ir_visit_instruction(i, &mark_used);
+        }
+        ir_visit_terminator(&block->terminator, &mark_used);
+    }
+    for(size_t locali = f->argc; locali < f->local_count; locali += 1) {
+        if(!used[locali] || f->locals[locali].is_in_frame) { continue; }
+        WRITE("    ");
+        emit_local_type(f, locali, symbols, typesdefs, types, out);
+        WRITE_C(' ');
+        emit_local(f, locali, out);
+        WRITE(";\n");
+    }
+    bool reachable[f->block_count];
+    bool is_target[f->block_count];
+    for(size_t blocki = 0; blocki < f->block_count; blocki += 1) {
+        reachable[blocki] = false;
+        is_target[blocki] = false;
+    }
+    mark_reachable(f, 0, reachable);
+    for(size_t blocki = 0; blocki < f->block_count; blocki += 1) {
+        if(!reachable[blocki]) { continue; }
+        size_t next = fallthrough_of(f, blocki, reachable);
+        IrTerminator* t = &f->blocks[blocki].terminator;
+        switch(t->type) {
+            case IR_JUMP:
+                if(t->value.jump.to != next) {
+                    is_target[t->value.jump.to] = true;
+                }
+                break;
+            case IR_BRANCH:
+                if(t->value.branch.if_true != next) {
+                    is_target[t->value.branch.if_true] = true;
+                }
+                if(t->value.branch.if_false != next) {
+                    is_target[t->value.branch.if_false] = true;
+                }
+                break;
+            case IR_SWITCH:
+                for(size_t ci = 0; ci < t->value.switch_on.casec; ci += 1) {
+                    is_target[t->value.switch_on.casev[ci].to] = true;
+                }
+                is_target[t->value.switch_on.otherwise] = true;
+                break;
+        }
+    }
+    if(f->is_async) {
+        // suspension points are numbered from 1 in the order of emission
+        WRITE("    switch(frame->_state) {\n        case 0: break;\n");
+        size_t suspension = 0;
+        for(size_t blocki = 0; blocki < f->block_count; blocki += 1) {
+            if(!reachable[blocki]) { continue; }
+            IrBlock* block = f->blocks + blocki;
+            for(size_t ii = 0; ii < block->instruction_count; ii += 1) {
+                if(!is_suspension(block->instructions + ii)) { continue; }
+                suspension += 1;
+                WRITE("        case ");
+                emit_size(suspension, out);
+                WRITE(": goto resume");
+                emit_size(suspension, out);
+                WRITE(";\n");
+            }
+        }
+        WRITE("        default: return true;\n    }\n");
+    }
+    size_t suspension = 0;
+    // the loops that have been opened with 'while(1) {', innermost last
+    size_t open_loops[f->loop_count + 1];
+    size_t open_loop_count = 0;
+    for(size_t blocki = 0; blocki < f->block_count; blocki += 1) {
+        if(!reachable[blocki]) { continue; }
+        while(open_loop_count > 0 && !loop_contains(
+            f->loops + open_loops[open_loop_count - 1], blocki
+        )) {
+            open_loop_count -= 1;
+            WRITE("    }\n");
+        }
+        // outer loops come last
+        for(size_t loopi = f->loop_count; loopi > 0; loopi -= 1) {
+            IrLoop* loop = f->loops + loopi - 1;
+            if(loop->header != blocki || !is_emitted_loop(loop, reachable)) {
+                continue;
+            }
+            emit_loop_pragmas(loop, out);
+            WRITE("    while(1) {\n");
+            open_loops[open_loop_count] = loopi - 1;
+            open_loop_count += 1;
+        }
+        IrBlock* block = f->blocks + blocki;
+        if(is_target[blocki]) {
+            emit_block_label(blocki, out);
+            WRITE(":\n");
+        }
+        for(size_t ii = 0; ii < block->instruction_count; ii += 1) {
+            emit_instruction(
+                f, block->instructions + ii, &suspension, program, symbols,
+                typesdefs, types, out
+            );
+        }
+        bool wrote_terminator = emit_terminator(
+            f, &block->terminator, fallthrough_of(f, blocki, reachable),
+            innermost_loop(f, blocki), symbols, typesdefs, types, out
+        );
+        if(is_target[blocki] && block->instruction_count == 0
+            && !wrote_terminator) {
+            WRITE("    ;\n");
+        }
+    }
+    for(; open_loop_count > 0; open_loop_count -= 1) { WRITE("    }\n"); }
+    WRITE("}\n");
+    if(f->is_parallel_body) {
+        emit_parallel_entry(f, symbols, typesdefs, types, out);
+    }
+}
+
+// the emitted function also reads the arguments passed through pointers and
+// writes a large returned value to memory
+static IrPurity emitted_purity(IrFunction* f) {
+    if(f->returns_by_pointer) { return IR_IMPURE; }
+    for(size_t argi = 0; argi < f->argc; argi += 1) {
+        if(f->locals[argi].is_by_pointer && f->purity == IR_CONST) {
+            return IR_PURE;
+        }
+    }
+    return f->purity;
+}
+
+static void emit_purity(
+    IrPurity purity, Node* return_type, StringBuilder* out
+) {
+    // the attributes only have a meaning for functions returning a value
+    if(ir_type_is_unit(return_type)) { return; }
+    switch(purity) {
+        case IR_CONST: WRITE("__attribute__((const)) "); break;
+        case IR_PURE: WRITE("__attribute__((pure)) "); break;
+        case IR_IMPURE: break;
+    }
+}
+
+// writes an initializer for a constant of the type
+static void emit_constant_value(
+    IrConstantValue* v, Node* type, SymbolTable* symbols,
+    StringBuilder* typesdefs, ArrayBuilder(RecordEntry)* types,
+    StringBuilder* out
+) {
+    switch(v->type) {
+        case IR_CONSTANT_INTEGER: {
+            bool is_signed = string_char_at(
+                type->value.namespace_access.path.elements[0], 0
+            ) == 's';
+            WRITE("((");
+            WRITE_TYPE(type);
+            WRITE(") ");
+            char digits[32];
+            if(!is_signed) {
+                snprintf(digits, sizeof(digits), "%llu",
+                    (unsigned long long) v->value.integer
+                );
+            } else if(v->value.integer == (uint64_t) INT64_MIN) {
+                // '-9223372036854775808' would not fit a signed literal
+                snprintf(digits, sizeof(digits), "(%lld - 1)",
+                    (long long) INT64_MIN + 1
+                );
+            } else {
+                snprintf(digits, sizeof(digits), "%lld",
+                    (long long) (int64_t) v->value.integer
+                );
+            }
+            WRITE(digits);
+            WRITE_C(')');
+            return;
+        }
+        case IR_CONSTANT_FLOAT: {
+            bool is_f32 = ir_type_is_core(type, "f32");
+            double x = v->value.floating;
+            if(isnan(x)) {
+                WRITE(is_f32? "__builtin_nanf(\"\")" : "__builtin_nan(\"\")");
+                return;
+            }
+            if(isinf(x)) {
+                if(x < 0.0) { WRITE_C('-'); }
+                WRITE(is_f32? "__builtin_inff()" : "__builtin_inf()");
+                return;
+            }
+            // enough digits to give the same value when read back
+            char digits[40];
+            snprintf(digits, sizeof(digits), is_f32? "%.9g" : "%.17g", x);
+            WRITE(digits);
+            if(strpbrk(digits, ".e") == NULL) { WRITE(".0"); }
+            if(is_f32) { WRITE_C('f'); }
+            return;
+        }
+        case IR_CONSTANT_BOOLEAN:
+            WRITE(v->value.boolean? "true" : "false");
+            return;
+        case IR_CONSTANT_AGGREGATE:
+            break;
+        default:
+            panic("UNHANDLED CONSTANT VALUE!");
+    }
+    size_t count = v->value.aggregate.count;
+    IrConstantValue* values = v->value.aggregate.values;
+    if(v->value.aggregate.names != NULL) {
+        Node* record = s_table_lookup(
+            symbols, type->value.namespace_access.path
+        )->variants + type->value.namespace_access.variant;
+        WRITE("{ ");
+        for(size_t vi = 0; vi < count; vi += 1) {
+            if(vi > 0) { WRITE(", "); }
+            WRITE_C('.');
+            WRITE_S(v->value.aggregate.names[vi]);
+            WRITE(" = ");
+            emit_constant_value(
+                values + vi, record->value.record.argtypev + vi, symbols,
+                typesdefs, types, out
+            );
+        }
+        WRITE(" }");
+        return;
+    }
+    bool is_vector = ir_type_is_vector(type);
+    Node element = is_vector? *type : *type->value.array_type.of;
+    String lane = is_vector? ir_vector_element(type) : string_wrap_nt("");
+    if(is_vector) { element.value.namespace_access.path.elements = &lane; }
+    WRITE(is_vector? "{ " : "{ .data = { ");
+    for(size_t vi = 0; vi < count; vi += 1) {
+        if(vi > 0) { WRITE(", "); }
+        emit_constant_value(
+            values + vi, &element, symbols, typesdefs, types, out
+        );
+    }
+    WRITE(is_vector? " }" : " } }");
+}
+
+static void emit_symbol_variant_pre(
+    Node* symbol, size_t variant, IrProgram* program, SymbolTable* symbols,
+    StringBuilder* typesdefs, ArrayBuilder(RecordEntry)* types,
+    StringBuilder* out
+) {
+    switch(symbol->type) {
+        case RECORD_NODE:
+            WRITE("typedef struct ");
+            emit_path(&symbol->value.record.path, variant, out);
             WRITE_C(' ');
             emit_path(&symbol->value.record.path, variant, out);
             WRITE(";\n");
             break;
-        case FUNCTION_NODE:
-            WRITE_TYPE(symbol->value.function.return_type);
+        case UNION_NODE:
+            WRITE("typedef struct ");
+            emit_path(&symbol->value.tagged_union.path, variant, out);
+            WRITE_C(' ');
+            emit_path(&symbol->value.tagged_union.path, variant, out);
+            WRITE(";\n");
+            break;
+        case FUNCTION_NODE: {
+            if(symbol->value.function.is_async) {
+                WRITE("static bool ");
+                emit_path(&symbol->value.function.path, variant, out);
+                WRITE("_resume(void* context);\n");
+                break;
+            }
+            IrFunction* f = ir_program_lookup(
+                program, symbol->value.function.path, variant
+            );
+            emit_function_attributes(&symbol->value.function.attributes, out);
+            if(f != NULL) {
+                emit_purity(
+                    emitted_purity(f), symbol->value.function.return_type, out
+                );
+            }
+            bool returns_by_pointer = f != NULL && f->returns_by_pointer;
+            emit_return_type(
+                f, symbol->value.function.return_type, symbols, typesdefs,
+                types, out
+            );
             WRITE_C(' ');
             emit_path(&symbol->value.function.path, variant, out);
             WRITE_C('(');
             size_t fun_argc = symbol->value.function.argc;
             for(size_t argi = 0; argi < fun_argc; argi += 1) {
                 if(argi > 0) { WRITE(", "); }
-                WRITE_TYPE(symbol->value.function.argtypev + argi);
-                WRITE_C(' ');
+                bool is_by_pointer = f != NULL && f->locals[argi].is_by_pointer;
+                if(is_by_pointer) { WRITE("const "); }
+                if(f != NULL && f->locals[argi].is_opaque_pointer) {
+                    WRITE("void*");
+                } else {
+                    WRITE_TYPE(symbol->value.function.argtypev + argi);
+                }
+                WRITE(is_by_pointer? "* " : " ");
                 WRITE_S(symbol->value.function.argnamev[argi]);
             }
+            if(returns_by_pointer) {
+                if(fun_argc > 0) { WRITE(", "); }
+                WRITE_TYPE(symbol->value.function.return_type);
+                WRITE("* _out");
+            }
             WRITE(");\n");
             break;
+        }
+        case CONSTANT_NODE:
+        case GLOBAL_NODE: {
+            IrConstant* c = ir_program_lookup_constant(
+                program, symbol->type == CONSTANT_NODE
+                    ? symbol->value.constant.path : symbol->value.global.path
+            );
+            if(c == NULL || !c->is_evaluated) {
+                panic("CONSTANT WAS NOT EVALUATED!");
+            }
+            // constants end up in read-only memory
+            WRITE("static ");
+            if(c->is_thread_local) { WRITE("_Thread_local "); }
+            if(!c->is_variable) { WRITE("const "); }
+            WRITE_TYPE(c->type);
+            WRITE_C(' ');
+            emit_path(&c->path, 0, out);
+            WRITE(" = ");
+            emit_constant_value(
+                &c->value, c->type, symbols, typesdefs, types, out
+            );
+            WRITE(";\n");
+            break;
+        }
         case EXTERNAL_FUNCTION_NODE:
             WRITE("extern ");
+            emit_purity(
+                ir_external_purity(symbol),
+                symbol->value.external_function.return_type, out
+            );
             WRITE_TYPE(symbol->value.external_function.return_type);
             WRITE_C(' ');
             WRITE_S(symbol->value.external_function.external_name);
@@ -478,44 +1886,457 @@ static void emit_symbol_variant_pre(
     }
 }
 
-static void emit_symbol_variant(
-    Node* symbol, size_t variant, SymbolTable* symbols,
-    StringBuilder* typesdefs, ArrayBuilder(RecordEntry)* types,
-    StringBuilder* out
-) {
-    switch(symbol->type) {
-        case RECORD_NODE:
-            // fully declared when used
+typedef struct EmittedFunction {
+    Namespace path;
+    size_t variant;
+    StringBuilder definition;
+    StringBuilder key;
+    uint64_t hash;
+    bool is_folded;
+    size_t folded_into;
+} EmittedFunction;
+
+DEF_ARRAY_BUILDER(EmittedFunction)
+
+#define FNV1A_START 14695981039346656037ULL
+
+static uint64_t fnv1a(uint64_t hash, const char* data, size_t length) {
+    for(size_t i = 0; i < length; i += 1) {
+        hash ^= (uint8_t) data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint64_t function_name_hash(Namespace path, size_t variant) {
+    uint64_t hash = FNV1A_START;
+    for(size_t ei = 0; ei < path.length; ei += 1) {
+        hash = fnv1a(hash, path.elements[ei].data, path.elements[ei].length);
+        hash = fnv1a(hash, "::", 2);
+    }
+    return fnv1a(hash, (const char*) &variant, sizeof(size_t));
+}
+
+// an open addressing table of indices into the emitted functions, which has
+// at least twice as many slots as there are functions
+typedef struct EmittedFunctionTable {
+    size_t* slots;
+    size_t mask;
+} EmittedFunctionTable;
+
+static EmittedFunctionTable emitted_function_table_new(size_t count) {
+    size_t capacity = 8;
+    while(capacity < count * 2) { capacity *= 2; }
+    EmittedFunctionTable t = (EmittedFunctionTable) {
+        .slots = (size_t*) malloc(sizeof(size_t) * capacity),
+        .mask = capacity - 1
+    };
+    for(size_t si = 0; si < capacity; si += 1) { t.slots[si] = SIZE_MAX; }
+    return t;
+}
+
+// builds the emitted definition of a function variant with every occurrence
+// of its own name (signature and recursive calls) replaced by '$', so that
+// variants with equal C signatures and bodies get equal keys
+static void build_emitted_function_key(EmittedFunction* f) {
+    StringBuilder name = stringbuilder_new();
+    emit_path(&f->path, f->variant, &name);
+    f->key = stringbuilder_new();
+    char* d = f->definition.buffer;
+    size_t length = f->definition.length;
+    for(size_t i = 0; i < length; i += 1) {
+        bool is_name = i + name.length <= length
+            && memcmp(d + i, name.buffer, name.length) == 0
+            && (i == 0 || !is_alphanumeral(d[i - 1]))
+            && (i + name.length == length
+                || !is_alphanumeral(d[i + name.length]));
+        if(is_name) {
+            stringbuilder_push_char(&f->key, '$');
+            i += name.length - 1;
+        } else {
+            stringbuilder_push_char(&f->key, d[i]);
+        }
+    }
+    stringbuilder_free(&name);
+    f->hash = fnv1a(FNV1A_START, f->key.buffer, f->key.length);
+}
+
+static bool emitted_function_eq(EmittedFunction* a, EmittedFunction* b) {
+    if(a->hash != b->hash) { return false; }
+    if(a->key.length != b->key.length) { return false; }
+    return memcmp(a->key.buffer, b->key.buffer, a->key.length) == 0;
+}
+
+// identical code folding - every function variant whose emitted C is
+// identical to an earlier one is replaced by a '#define' to the earlier one
+// (template variants only differing in the types behind pointers they never
+// dereference emit the same C, see 'choose_opaque_pointers')
+static void fold_emitted_functions(ArrayBuilder(EmittedFunction)* functions) {
+    EmittedFunction* fv = (EmittedFunction*) functions->buffer;
+    // the functions that have not been folded, by their keys
+    EmittedFunctionTable kept = emitted_function_table_new(
+        functions->length
+    );
+    for(size_t fi = 0; fi < functions->length; fi += 1) {
+        build_emitted_function_key(fv + fi);
+        size_t si = fv[fi].hash & kept.mask;
+        for(; kept.slots[si] != SIZE_MAX; si = (si + 1) & kept.mask) {
+            size_t ci = kept.slots[si];
+            if(!emitted_function_eq(fv + ci, fv + fi)) { continue; }
+            fv[fi].is_folded = true;
+            fv[fi].folded_into = ci;
             break;
-        case FUNCTION_NODE:
-            WRITE_TYPE(symbol->value.function.return_type);
-            WRITE_C(' ');
-            emit_path(&symbol->value.function.path, variant, out);
-            WRITE_C('(');
-            size_t fun_argc = symbol->value.function.argc;
-            for(size_t argi = 0; argi < fun_argc; argi += 1) {
-                if(argi > 0) { WRITE(", "); }
-                WRITE_TYPE(symbol->value.function.argtypev + argi);
-                WRITE_C(' ');
-                WRITE_S(symbol->value.function.argnamev[argi]);
+        }
+        if(!fv[fi].is_folded) { kept.slots[si] = fi; }
+    }
+    free(kept.slots);
+}
+
+// the emitted functions by their paths and variants
+static EmittedFunctionTable index_emitted_functions(
+    ArrayBuilder(EmittedFunction)* functions
+) {
+    EmittedFunction* fv = (EmittedFunction*) functions->buffer;
+    EmittedFunctionTable t = emitted_function_table_new(functions->length);
+    for(size_t fi = 0; fi < functions->length; fi += 1) {
+        size_t si = function_name_hash(fv[fi].path, fv[fi].variant) & t.mask;
+        while(t.slots[si] != SIZE_MAX) { si = (si + 1) & t.mask; }
+        t.slots[si] = fi;
+    }
+    return t;
+}
+
+static EmittedFunction* find_emitted_function(
+    ArrayBuilder(EmittedFunction)* functions, EmittedFunctionTable* index,
+    Namespace path, size_t variant
+) {
+    EmittedFunction* fv = (EmittedFunction*) functions->buffer;
+    size_t si = function_name_hash(path, variant) & index->mask;
+    for(; index->slots[si] != SIZE_MAX; si = (si + 1) & index->mask) {
+        EmittedFunction* f = fv + index->slots[si];
+        if(f->variant == variant && namespace_eq(f->path, path)) { return f; }
+    }
+    return NULL;
+}
+
+// marks the arguments that are never written, which are passed through a
+// pointer if they are large, and large returned values
+static void choose_value_passing(IrProgram* program, SymbolTable* symbols) {
+    for(size_t fi = 0; fi < program->function_count; fi += 1) {
+        IrFunction* f = program->functions + fi;
+        // async functions keep them in their frame
+        if(f->is_async) { continue; }
+        f->returns_by_pointer = is_large_value(f->return_type, symbols);
+        bool is_written[f->argc + 1];
+        for(size_t argi = 0; argi < f->argc; argi += 1) {
+            is_written[argi] = f->locals[argi].is_address_taken;
+        }
+        for(size_t blocki = 0; blocki < f->block_count; blocki += 1) {
+            IrBlock* block = f->blocks + blocki;
+            for(size_t ii = 0; ii < block->instruction_count; ii += 1) {
+                IrInstruction* i = block->instructions + ii;
+                if(i->has_dest && i->dest < f->argc) {
+                    is_written[i->dest] = true;
+                }
+                bool stores_argument = i->type == IR_STORE
+                    && i->value.store.to.type == IR_PLACE_LOCAL
+                    && i->value.store.to.base.local < f->argc;
+                if(stores_argument) {
+                    is_written[i->value.store.to.base.local] = true;
+                }
             }
-            WRITE(") { ");
-            emit_block(
-                symbol->value.function.body, symbols, typesdefs, types, out
-            );
-            WRITE(" }\n");
-            break;
-        case EXTERNAL_FUNCTION_NODE:
-            break;
-        default:
-            panic("UNHANDLED NODE TYPE!");
+        }
+        for(size_t argi = 0; argi < f->argc; argi += 1) {
+            f->locals[argi].is_by_pointer = !is_written[argi]
+                && is_large_value(f->locals[argi].type, symbols);
+        }
+    }
+}
+
+typedef struct FrameUses {
+    IrFunction* f;
+    size_t block;
+    // the suspension points passed in the block so far
+    size_t suspensions;
+    // where each local has first been referenced, SIZE_MAX if it has not
+    size_t* first_block;
+    size_t* first_suspensions;
+} FrameUses;
+
+static void reference_local(FrameUses* u, size_t local, bool defines) {
+    IrLocal* l = u->f->locals + local;
+    if(u->first_block[local] == SIZE_MAX) {
+        u->first_block[local] = u->block;
+        u->first_suspensions[local] = u->suspensions;
+        // otherwise the value comes from before the block
+        if(!defines) { l->is_in_frame = true; }
+        return;
+    }
+    if(u->first_block[local] != u->block
+        || u->first_suspensions[local] != u->suspensions) {
+        l->is_in_frame = true;
+    }
+}
+
+static void reference_value(IrValue* v, void* data) {
+    if(v->type == IR_VALUE_LOCAL) {
+        reference_local((FrameUses*) data, v->value.local, false);
+    }
+}
+
+static void reference_place(IrPlace* p, void* data) {
+    if(p->type == IR_PLACE_LOCAL) {
+        reference_local((FrameUses*) data, p->base.local, false);
     }
 }
 
-StringBuilder generate_code(SymbolTable* symbols, Namespace* main) {
+// keeps the locals of async functions in their frame, except temporaries
+// that are defined and used between the same suspension points of a block
+static void choose_frame_locals(IrProgram* program) {
+    for(size_t fi = 0; fi < program->function_count; fi += 1) {
+        IrFunction* f = program->functions + fi;
+        if(!f->is_async) { continue; }
+        size_t first_block[f->local_count + 1];
+        size_t first_suspensions[f->local_count + 1];
+        for(size_t locali = 0; locali < f->local_count; locali += 1) {
+            IrLocal* local = f->locals + locali;
+            // the arguments are written by the caller
+            local->is_in_frame = locali < f->argc || !local->is_temporary
+                || local->is_address_taken;
+            first_block[locali] = SIZE_MAX;
+        }
+        FrameUses uses = (FrameUses) {
+            .f = f,
+            .first_block = first_block,
+            .first_suspensions = first_suspensions
+        };
+        IrVisitor reference = (IrVisitor) {
+            .visit_value = &reference_value,
+            .visit_place = &reference_place,
+            .data = &uses
+        };
+        for(size_t blocki = 0; blocki < f->block_count; blocki += 1) {
+            IrBlock* block = f->blocks + blocki;
+            uses.block = blocki;
+            uses.suspensions = 0;
+            for(size_t ii = 0; ii < block->instruction_count; ii += 1) {
+                IrInstruction* i = block->instructions + ii;
+                ir_visit_instruction(i, &reference);
+                // the result of an await is written after resuming
+                if(is_suspension(i)) { uses.suspensions += 1; }
+                if(i->has_dest) { reference_local(&uses, i->dest, true); }
+            }
+            ir_visit_terminator(&block->terminator, &reference);
+        }
+    }
+}
+
+// a pointer type without qualifiers, which 'void*' can stand for
+static bool is_plain_pointer(Node* type) {
+    return type->type == POINTER_TYPE_NODE
+        && !type->value.pointer_type.is_const
+        && !type->value.pointer_type.is_restrict;
+}
+
+static void reveal_pointer(IrFunction* f, IrValue* v) {
+    if(v->type == IR_VALUE_LOCAL) {
+        f->locals[v->value.local].is_opaque_pointer = false;
+    }
+}
+
+static void reveal_dereferenced(IrPlace* p, void* data) {
+    if(p->type == IR_PLACE_DEREF) {
+        reveal_pointer((IrFunction*) data, &p->base.pointer);
+    }
+}
+
+// finds the pointers of template variants that are never dereferenced,
+// offset or passed to external functions (which may need to know what
+// they point to), so variants only differing in their pointee types fold
+static void choose_opaque_pointers(IrProgram* program, SymbolTable* symbols) {
+    for(size_t fi = 0; fi < program->function_count; fi += 1) {
+        IrFunction* f = program->functions + fi;
+        if(f->is_async || f->is_parallel_body) { continue; }
+        Node* function = s_table_lookup(symbols, f->path)->variants
+            + f->variant;
+        if(function->value.function.template_argc == 0) { continue; }
+        f->returns_opaque_pointer = !f->returns_by_pointer
+            && is_plain_pointer(f->return_type);
+        for(size_t locali = 0; locali < f->local_count; locali += 1) {
+            IrLocal* local = f->locals + locali;
+            local->is_opaque_pointer = is_plain_pointer(local->type)
+                && !local->is_address_taken && !local->is_by_pointer;
+        }
+        IrVisitor reveal = (IrVisitor) {
+            .visit_value = NULL,
+            .visit_place = &reveal_dereferenced,
+            .data = f
+        };
+        for(size_t blocki = 0; blocki < f->block_count; blocki += 1) {
+            IrBlock* block = f->blocks + blocki;
+            for(size_t ii = 0; ii < block->instruction_count; ii += 1) {
+                IrInstruction* i = block->instructions + ii;
+                ir_visit_instruction(i, &reveal);
+                switch(i->type) {
+                    case IR_UNARY:
+                        reveal_pointer(f, &i->value.unary.x);
+                        break;
+                    case IR_BINARY: {
+                        NodeType op = i->value.binary.op;
+                        // only comparisons for equality are done on 'void*'
+                        if(op == EQUALS_NODE || op == NOT_EQUALS_NODE) {
+                            break;
+                        }
+                        reveal_pointer(f, &i->value.binary.a);
+                        reveal_pointer(f, &i->value.binary.b);
+                        break;
+                    }
+                    case IR_SLICE:
+                        reveal_pointer(f, &i->value.slice.data);
+                        break;
+                    case IR_CALL:
+                        if(!i->value.call.is_external) { break; }
+                        size_t argc = i->value.call.argc;
+                        for(size_t argi = 0; argi < argc; argi += 1) {
+                            reveal_pointer(f, i->value.call.argv + argi);
+                        }
+                        break;
+                }
+            }
+        }
+    }
+}
+
+// the runtime of 'par' loops, which gives parts of the indices to a pool of
+// threads started by the first loop (or to OpenMP if compiled with it)
+static const char* PARALLEL_RUNTIME =
+    "typedef void (*nino_parallel_body_t)(void*, size_t, size_t);\n"
+    "\n"
+    "#ifdef _OPENMP\n"
+    "#include <omp.h>\n"
+    "\n"
+    "static void nino_parallel_for(\n"
+    "    nino_parallel_body_t body, void* context, size_t start, size_t end\n"
+    ") {\n"
+    "    if(end <= start) { return; }\n"
+    "    size_t threadc = (size_t) omp_get_max_threads();\n"
+    "    size_t chunk = (end - start) / (threadc * 8) + 1;\n"
+    "    size_t chunkc = (end - start - 1) / chunk + 1;\n"
+    "    #pragma omp parallel for schedule(dynamic, 1)\n"
+    "    for(size_t ci = 0; ci < chunkc; ci += 1) {\n"
+    "        size_t low = start + ci * chunk;\n"
+    "        body(context, low, end - low < chunk? end : low + chunk);\n"
+    "    }\n"
+    "}\n"
+    "#else\n"
+    "#include <pthread.h>\n"
+    "#include <sched.h>\n"
+    "#include <unistd.h>\n"
+    "\n"
+    "// the threads of the pool take chunks of the indices from 'next'\n"
+    "typedef struct {\n"
+    "    nino_parallel_body_t body;\n"
+    "    void* context;\n"
+    "    size_t end;\n"
+    "    size_t chunk;\n"
+    "    atomic_size_t next;\n"
+    "    // the threads of the pool that have not finished the loop yet\n"
+    "    atomic_size_t running;\n"
+    "} nino_parallel_loop_t;\n"
+    "\n"
+    "static pthread_once_t nino_parallel_once = PTHREAD_ONCE_INIT;\n"
+    "static pthread_mutex_t nino_parallel_lock = PTHREAD_MUTEX_INITIALIZER;\n"
+    "static pthread_cond_t nino_parallel_started = PTHREAD_COND_INITIALIZER;\n"
+    "static size_t nino_parallel_threadc = 0;\n"
+    "static nino_parallel_loop_t* nino_parallel_loop = NULL;\n"
+    "static size_t nino_parallel_generation = 0;\n"
+    "static atomic_bool nino_parallel_busy = false;\n"
+    "static _Thread_local bool nino_parallel_inside = false;\n"
+    "\n"
+    "static void nino_parallel_take(nino_parallel_loop_t* loop) {\n"
+    "    for(;;) {\n"
+    "        size_t low = atomic_fetch_add(&loop->next, loop->chunk);\n"
+    "        if(low >= loop->end) { return; }\n"
+    "        size_t high = loop->end - low < loop->chunk\n"
+    "            ? loop->end : low + loop->chunk;\n"
+    "        loop->body(loop->context, low, high);\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "static void* nino_parallel_thread(void* unused) {\n"
+    "    (void) unused;\n"
+    "    nino_parallel_inside = true;\n"
+    "    size_t seen = 0;\n"
+    "    for(;;) {\n"
+    "        pthread_mutex_lock(&nino_parallel_lock);\n"
+    "        while(nino_parallel_generation == seen) {\n"
+    "            pthread_cond_wait(\n"
+    "                &nino_parallel_started, &nino_parallel_lock\n"
+    "            );\n"
+    "        }\n"
+    "        seen = nino_parallel_generation;\n"
+    "        nino_parallel_loop_t* loop = nino_parallel_loop;\n"
+    "        pthread_mutex_unlock(&nino_parallel_lock);\n"
+    "        nino_parallel_take(loop);\n"
+    "        atomic_fetch_sub(&loop->running, 1);\n"
+    "    }\n"
+    "    return NULL;\n"
+    "}\n"
+    "\n"
+    "static void nino_parallel_start(void) {\n"
+    "    long cores = sysconf(_SC_NPROCESSORS_ONLN);\n"
+    "    for(long ti = 1; ti < cores; ti += 1) {\n"
+    "        pthread_t thread;\n"
+    "        bool failed = pthread_create(\n"
+    "            &thread, NULL, &nino_parallel_thread, NULL\n"
+    "        ) != 0;\n"
+    "        if(failed) { break; }\n"
+    "        pthread_detach(thread);\n"
+    "        nino_parallel_threadc += 1;\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "static void nino_parallel_for(\n"
+    "    nino_parallel_body_t body, void* context, size_t start, size_t end\n"
+    ") {\n"
+    "    if(end <= start) { return; }\n"
+    "    pthread_once(&nino_parallel_once, &nino_parallel_start);\n"
+    "    // nested loops and loops started while the pool is busy run on the\n"
+    "    // calling thread\n"
+    "    if(nino_parallel_inside || nino_parallel_threadc == 0\n"
+    "        || atomic_exchange(&nino_parallel_busy, true)) {\n"
+    "        body(context, start, end);\n"
+    "        return;\n"
+    "    }\n"
+    "    nino_parallel_loop_t loop = {\n"
+    "        .body = body, .context = context, .end = end,\n"
+    "        .chunk = (end - start) / ((nino_parallel_threadc + 1) * 8) + 1\n"
+    "    };\n"
+    "    atomic_init(&loop.next, start);\n"
+    "    atomic_init(&loop.running, nino_parallel_threadc);\n"
+    "    pthread_mutex_lock(&nino_parallel_lock);\n"
+    "    nino_parallel_loop = &loop;\n"
+    "    nino_parallel_generation += 1;\n"
+    "    pthread_cond_broadcast(&nino_parallel_started);\n"
+    "    pthread_mutex_unlock(&nino_parallel_lock);\n"
+    "    nino_parallel_inside = true;\n"
+    "    nino_parallel_take(&loop);\n"
+    "    nino_parallel_inside = false;\n"
+    "    while(atomic_load(&loop.running) > 0) { sched_yield(); }\n"
+    "    atomic_store(&nino_parallel_busy, false);\n"
+    "}\n"
+    "#endif\n"
+    "\n";
+
+StringBuilder generate_code(
+    SymbolTable* symbols, IrProgram* program, Namespace* main
+) {
     StringBuilder out = stringbuilder_new();
     StringBuilder typesdefs = stringbuilder_new();
     ArrayBuilder(RecordEntry) types = arraybuilder_new(RecordEntry)();
+    ArrayBuilder(EmittedFunction) functions = arraybuilder_new(
+        EmittedFunction
+    )();
     stringbuilder_push_nt_string(&out,
         "\n"
         "// C output generated by the Nino bootstrap compiler\n"
@@ -524,39 +2345,97 @@ StringBuilder generate_code(SymbolTable* symbols, Namespace* main) {
         "#include <stddef.h>\n"
         "#include <stdint.h>\n"
         "#include <stdbool.h>\n"
+        "#include <stdatomic.h>\n"
         "\n"
     );
+    choose_value_passing(program, symbols);
+    choose_frame_locals(program);
+    choose_opaque_pointers(program, symbols);
+    for(size_t fi = 0; fi < program->function_count; fi += 1) {
+        if(!program->functions[fi].is_parallel_body) { continue; }
+        stringbuilder_push_nt_string(&out, PARALLEL_RUNTIME);
+        break;
+    }
+    for(size_t fi = 0; fi < program->function_count; fi += 1) {
+        IrFunction* irf = program->functions + fi;
+        EmittedFunction f;
+        f.path = irf->path;
+        f.variant = irf->variant;
+        f.definition = stringbuilder_new();
+        f.is_folded = false;
+        emit_ir_function(
+            irf, program, symbols, &typesdefs, &types, &f.definition
+        );
+        arraybuilder_push(EmittedFunction)(&functions, f);
+    }
+    fold_emitted_functions(&functions);
+    EmittedFunctionTable function_index = index_emitted_functions(&functions);
+    EmittedFunction* fv = (EmittedFunction*) functions.buffer;
+    // prototypes may declare types, so they are written after the types
+    StringBuilder prototypes = stringbuilder_new();
     for(size_t symboli = 0; symboli < symbols->count; symboli += 1) {
         Symbol* symbol = symbols->symbols + symboli;
         for(size_t vari = 0; vari < symbol->variant_count; vari += 1) {
+            EmittedFunction* f = find_emitted_function(
+                &functions, &function_index, symbol->path, vari
+            );
+            if(f != NULL && f->is_folded) {
+                EmittedFunction* into = fv + f->folded_into;
+                stringbuilder_push_nt_string(&prototypes, "#define ");
+                emit_path(&f->path, f->variant, &prototypes);
+                stringbuilder_push_char(&prototypes, ' ');
+                emit_path(&into->path, into->variant, &prototypes);
+                stringbuilder_push_char(&prototypes, '\n');
+                continue;
+            }
+            bool is_record = symbol->variants[vari].type == RECORD_NODE
+                || symbol->variants[vari].type == UNION_NODE;
             emit_symbol_variant_pre(
-                symbol->variants + vari, vari, symbols,
-                &typesdefs, &types, &out
+                symbol->variants + vari, vari, program, symbols,
+                &typesdefs, &types, is_record? &out : &prototypes
             );
         }
     }
     stringbuilder_push_nt_string(&out, "\n");
     stringbuilder_push(&out, typesdefs.length, typesdefs.buffer);
     stringbuilder_push_nt_string(&out, "\n");
-    for(size_t symboli = 0; symboli < symbols->count; symboli += 1) {
-        Symbol* symbol = symbols->symbols + symboli;
-        for(size_t vari = 0; vari < symbol->variant_count; vari += 1) {
-            emit_symbol_variant(
-                symbol->variants + vari, vari, symbols,
-                &typesdefs, &types, &out
+    stringbuilder_push(&out, prototypes.length, prototypes.buffer);
+    stringbuilder_push_nt_string(&out, "\n");
+    stringbuilder_free(&prototypes);
+    free(function_index.slots);
+    for(size_t fi = 0; fi < functions.length; fi += 1) {
+        if(!fv[fi].is_folded) {
+            stringbuilder_push(
+                &out, fv[fi].definition.length, fv[fi].definition.buffer
             );
         }
+        stringbuilder_free(&fv[fi].definition);
+        stringbuilder_free(&fv[fi].key);
     }
     if(main != NULL) {
         stringbuilder_push_nt_string(&out, "\n");
         stringbuilder_push_nt_string(&out, "int main() {\n");
         stringbuilder_push_nt_string(&out, "    ");
         emit_path(main, 0, &out);
-        stringbuilder_push_nt_string(&out, "();\n");
+        IrFunction* main_function = ir_program_lookup(program, *main, 0);
+        if(main_function != NULL && main_function->is_async) {
+            panic("The main function can not be async!");
+        }
+        if(main_function != NULL && main_function->returns_by_pointer) {
+            // the returned value is discarded
+            stringbuilder_push_nt_string(&out, "(&(");
+            emit_type(
+                main_function->return_type, symbols, &typesdefs, &types, &out
+            );
+            stringbuilder_push_nt_string(&out, ") { 0 });\n");
+        } else {
+            stringbuilder_push_nt_string(&out, "();\n");
+        }
         stringbuilder_push_nt_string(&out, "    return 0;\n");
         stringbuilder_push_nt_string(&out, "}\n");
     }
     stringbuilder_free(&typesdefs);
     arraybuilder_discard(RecordEntry)(&types);
+    arraybuilder_discard(EmittedFunction)(&functions);
     return out;
-}
\ No newline at end of file
+}
@@ -1,6 +1,7 @@
-
 #pragma once
-#include "symbols.h"
+#include "ir.h"
 
 
-StringBuilder generate_code(SymbolTable* symbols, Namespace* main);
\ No newline at end of file
+StringBuilder generate_code(
+    SymbolTable* symbols, IrProgram* program, Namespace* main
+);
@@ -0,0 +1,612 @@
+#include <stdio.h>
+#include <math.h>
+#include "evaluate.h"
+
+
+// after this many instructions the evaluation is assumed to never finish
+#define MAX_STEPS 100000000
+// deeper calls are refused before they overflow the stack of the compiler
+#define MAX_DEPTH 4096
+
+typedef struct {
+    IrProgram* program;
+    SymbolTable* symbols;
+    Arena* arena;
+    // of the constant currently being computed, including the constants it
+    // depends on
+    size_t steps;
+    // the number of function calls being evaluated
+    size_t depth;
+    // whether the value of each constant is currently being computed
+    bool* evaluating;
+} Evaluator;
+
+static void evaluate_constant(Evaluator* e, IrConstant* c);
+
+
+static IrConstantValue integer_value(uint64_t x) {
+    return (IrConstantValue) {
+        .type = IR_CONSTANT_INTEGER, .value = { .integer = x }
+    };
+}
+
+static IrConstantValue float_value(double x) {
+    return (IrConstantValue) {
+        .type = IR_CONSTANT_FLOAT, .value = { .floating = x }
+    };
+}
+
+static IrConstantValue boolean_value(bool x) {
+    return (IrConstantValue) {
+        .type = IR_CONSTANT_BOOLEAN, .value = { .boolean = x }
+    };
+}
+
+static size_t integer_bits(Node* type) {
+    String name = type->value.namespace_access.path.elements[0];
+    if(string_eq(name, string_wrap_nt("usize"))
+        || string_eq(name, string_wrap_nt("ssize"))) {
+        return sizeof(size_t) * 8;
+    }
+    STRING_AS_NT(string_slice(name, 1, name.length), digits);
+    return strtoull(digits, NULL, 10);
+}
+
+static bool is_signed(Node* type) {
+    return ir_type_is_integer(type) && string_char_at(
+        type->value.namespace_access.path.elements[0], 0
+    ) == 's';
+}
+
+// cuts off the bits that do not fit the type (sign extending signed types)
+static uint64_t wrap_integer(uint64_t x, Node* type) {
+    size_t bits = integer_bits(type);
+    if(bits >= 64) { return x; }
+    uint64_t mask = ((uint64_t) 1 << bits) - 1;
+    x &= mask;
+    if(is_signed(type) && ((x >> (bits - 1)) & 1)) { x |= ~mask; }
+    return x;
+}
+
+static double round_float(double x, Node* type) {
+    return ir_type_is_core(type, "f32")? (double) (float) x : x;
+}
+
+static IrConstantValue zero_value(Evaluator* e, Node* type) {
+    if(ir_type_is_integer(type)) { return integer_value(0); }
+    if(ir_type_is_float(type)) { return float_value(0.0); }
+    if(ir_type_is_core(type, "bool")) { return boolean_value(false); }
+    size_t count;
+    String* names = NULL;
+    Node* typev = NULL;
+    Node* element = NULL;
+    char lane_kind = 0;
+    if(type->type == ARRAY_TYPE_NODE) {
+        count = ir_array_length(type);
+        element = type->value.array_type.of;
+    } else if(ir_type_is_vector(type)) {
+        count = ir_vector_lanes(type);
+        lane_kind = string_char_at(ir_vector_element(type), 0);
+    } else {
+        Symbol* s = type->type == NAMESPACE_ACCESS_NODE
+            ? s_table_lookup(e->symbols, type->value.namespace_access.path)
+            : NULL;
+        Node* record = s == NULL? NULL
+            : s->variants + type->value.namespace_access.variant;
+        if(record == NULL || record->type != RECORD_NODE) {
+            panic("Type can not be used in constants!");
+        }
+        count = record->value.record.argc;
+        names = record->value.record.argnamev;
+        typev = record->value.record.argtypev;
+    }
+    IrConstantValue* values = (IrConstantValue*) arena_alloc(
+        e->arena, sizeof(IrConstantValue) * count
+    );
+    for(size_t vi = 0; vi < count; vi += 1) {
+        if(typev != NULL) { values[vi] = zero_value(e, typev + vi); }
+        else if(element != NULL) { values[vi] = zero_value(e, element); }
+        else if(lane_kind == 'f') { values[vi] = float_value(0.0); }
+        else { values[vi] = integer_value(0); }
+    }
+    return (IrConstantValue) {
+        .type = IR_CONSTANT_AGGREGATE,
+        .value = { .aggregate = {
+            .count = count, .names = names, .values = values
+        } }
+    };
+}
+
+// aggregates are copied when read as a whole, so that stores to their
+// elements never change other values
+static IrConstantValue copy_value(Evaluator* e, IrConstantValue v) {
+    if(v.type != IR_CONSTANT_AGGREGATE) { return v; }
+    size_t count = v.value.aggregate.count;
+    IrConstantValue* values = (IrConstantValue*) arena_alloc(
+        e->arena, sizeof(IrConstantValue) * count
+    );
+    for(size_t vi = 0; vi < count; vi += 1) {
+        values[vi] = copy_value(e, v.value.aggregate.values[vi]);
+    }
+    v.value.aggregate.values = values;
+    return v;
+}
+
+static size_t size_of(Node* type) {
+    if(ir_type_is_integer(type)) { return integer_bits(type) / 8; }
+    if(ir_type_is_core(type, "f32")) { return 4; }
+    if(ir_type_is_core(type, "f64")) { return 8; }
+    if(ir_type_is_core(type, "bool")) { return sizeof(bool); }
+    if(type->type == POINTER_TYPE_NODE) { return sizeof(void*); }
+    if(type->type == ARRAY_TYPE_NODE) {
+        return ir_array_length(type) * size_of(type->value.array_type.of);
+    }
+    panic("Size of type can not be computed in constants!");
+}
+
+
+typedef struct {
+    IrFunction* f;
+    IrConstantValue* locals;
+} Frame;
+
+static IrConstantValue evaluate_value(Evaluator* e, Frame* frame, IrValue* v) {
+    switch(v->type) {
+        case IR_VALUE_LOCAL: {
+            IrConstantValue local = frame->locals[v->value.local];
+            if(local.type == IR_CONSTANT_NONE) {
+                panic("LOCAL USED BEFORE IT WAS ASSIGNED!");
+            }
+            return copy_value(e, local);
+        }
+        case IR_VALUE_INTEGER: {
+            STRING_AS_NT(v->value.literal, digits);
+            char* end;
+            uint64_t x = digits[0] == '-'
+                ? (uint64_t) strtoll(digits, &end, 10)
+                : strtoull(digits, &end, 10);
+            if(*end != '\0') {
+                panic("Value can not be evaluated at compile time!");
+            }
+            if(ir_type_is_float(v->data_type)) {
+                return float_value(round_float(
+                    digits[0] == '-'? (double) (int64_t) x : (double) x,
+                    v->data_type
+                ));
+            }
+            return integer_value(wrap_integer(x, v->data_type));
+        }
+        case IR_VALUE_FLOAT: {
+            STRING_AS_NT(v->value.literal, digits);
+            return float_value(round_float(
+                strtod(digits, NULL), v->data_type
+            ));
+        }
+        case IR_VALUE_BOOLEAN:
+            return boolean_value(
+                string_eq(v->value.literal, string_wrap_nt("true"))
+            );
+        case IR_VALUE_SIZE_OF:
+            return integer_value(size_of(v->value.size_of));
+        default:
+            panic("Value can not be evaluated at compile time!");
+    }
+}
+
+static size_t evaluate_index(Evaluator* e, Frame* frame, IrValue* index) {
+    IrConstantValue i = evaluate_value(e, frame, index);
+    if(i.type != IR_CONSTANT_INTEGER) { panic("INDEX IS NOT AN INTEGER!"); }
+    return i.value.integer;
+}
+
+// gives the stored value, which elements of local aggregates can be
+// written to if 'writes' is true
+static IrConstantValue* evaluate_place(
+    Evaluator* e, Frame* frame, IrPlace* p, bool writes
+) {
+    IrConstantValue* v;
+    switch(p->type) {
+        case IR_PLACE_LOCAL: {
+            v = frame->locals + p->base.local;
+            bool initializes = writes && p->projectionc > 0
+                && v->type == IR_CONSTANT_NONE;
+            if(initializes) {
+                *v = zero_value(e, frame->f->locals[p->base.local].type);
+            }
+            break;
+        }
+        case IR_PLACE_CONSTANT: {
+            IrConstant* c = ir_program_lookup_constant(
+                e->program, p->base.constant
+            );
+            evaluate_constant(e, c);
+            v = &c->value;
+            break;
+        }
+        case IR_PLACE_GLOBAL:
+            panic("Global variables can not be used in constants!");
+        default:
+            panic("Pointers can not be used in constants!");
+    }
+    for(size_t pi = 0; pi < p->projectionc; pi += 1) {
+        IrProjection* projection = p->projectionv + pi;
+        if(v->type != IR_CONSTANT_AGGREGATE) {
+            panic("PROJECTION OF A VALUE THAT IS NOT AN AGGREGATE!");
+        }
+        size_t count = v->value.aggregate.count;
+        size_t i;
+        switch(projection->type) {
+            case IR_PROJECTION_MEMBER:
+                for(i = 0; i < count; i += 1) {
+                    String name = v->value.aggregate.names[i];
+                    if(string_eq(name, projection->member)) { break; }
+                }
+                break;
+            case IR_PROJECTION_INDEX:
+            case IR_PROJECTION_LANE:
+                i = evaluate_index(e, frame, &projection->index);
+                if(i >= count) { panic("Index out of bounds!"); }
+                break;
+            default:
+                panic("Slices can not be used in constants!");
+        }
+        v = v->value.aggregate.values + i;
+    }
+    return v;
+}
+
+static IrConstantValue evaluate_unary(
+    NodeType op, IrConstantValue x, Node* type
+) {
+    switch(op) {
+        case NEGATION_NODE:
+            if(x.type == IR_CONSTANT_FLOAT) {
+                return float_value(-x.value.floating);
+            }
+            return integer_value(wrap_integer(-x.value.integer, type));
+        case BITWISE_NOT_NODE:
+            return integer_value(wrap_integer(~x.value.integer, type));
+        case LOGICAL_NOT_NODE:
+            return boolean_value(!x.value.boolean);
+        default:
+            panic("UNHANDLED UNARY OPERATION!");
+    }
+}
+
+static IrConstantValue evaluate_comparison(
+    NodeType op, IrConstantValue a, IrConstantValue b, Node* operand_type
+) {
+    // -1, 0 or 1
+    int order;
+    if(a.type == IR_CONSTANT_FLOAT) {
+        double x = a.value.floating;
+        double y = b.value.floating;
+        // comparisons with NaN are false, except for '!='
+        if(isnan(x) || isnan(y)) { return boolean_value(op == NOT_EQUALS_NODE); }
+        order = x < y? -1 : x > y? 1 : 0;
+    } else if(a.type == IR_CONSTANT_BOOLEAN) {
+        order = (int) a.value.boolean - (int) b.value.boolean;
+    } else if(is_signed(operand_type)) {
+        int64_t x = (int64_t) a.value.integer;
+        int64_t y = (int64_t) b.value.integer;
+        order = x < y? -1 : x > y? 1 : 0;
+    } else {
+        uint64_t x = a.value.integer;
+        uint64_t y = b.value.integer;
+        order = x < y? -1 : x > y? 1 : 0;
+    }
+    switch(op) {
+        case EQUALS_NODE: return boolean_value(order == 0);
+        case NOT_EQUALS_NODE: return boolean_value(order != 0);
+        case LESS_THAN_NODE: return boolean_value(order < 0);
+        case GREATER_THAN_NODE: return boolean_value(order > 0);
+        case LESS_THAN_EQUAL_NODE: return boolean_value(order <= 0);
+        case GREATER_THAN_EQUAL_NODE: return boolean_value(order >= 0);
+        default: panic("UNHANDLED COMPARISON!");
+    }
+}
+
+static IrConstantValue evaluate_binary(
+    NodeType op, IrConstantValue a, IrConstantValue b, Node* operand_type,
+    Node* type
+) {
+    if(a.type == IR_CONSTANT_AGGREGATE || b.type == IR_CONSTANT_AGGREGATE) {
+        panic("Vector operations can not be evaluated in constants!");
+    }
+    switch(op) {
+        case EQUALS_NODE: case NOT_EQUALS_NODE:
+        case LESS_THAN_NODE: case GREATER_THAN_NODE:
+        case LESS_THAN_EQUAL_NODE: case GREATER_THAN_EQUAL_NODE:
+            return evaluate_comparison(op, a, b, operand_type);
+        default:
+            break;
+    }
+    if(a.type == IR_CONSTANT_FLOAT) {
+        double x = a.value.floating;
+        double y = b.value.floating;
+        switch(op) {
+            case ADDITION_NODE: return float_value(round_float(x + y, type));
+            case SUBTRACTION_NODE: return float_value(round_float(x - y, type));
+            case MULTIPLICATION_NODE:
+                return float_value(round_float(x * y, type));
+            case DIVISION_NODE: return float_value(round_float(x / y, type));
+            default: panic("UNHANDLED FLOAT OPERATION!");
+        }
+    }
+    uint64_t x = a.value.integer;
+    uint64_t y = b.value.integer;
+    bool is_signed_op = is_signed(operand_type);
+    uint64_t r;
+    switch(op) {
+        case ADDITION_NODE: r = x + y; break;
+        case SUBTRACTION_NODE: r = x - y; break;
+        case MULTIPLICATION_NODE: r = x * y; break;
+        case DIVISION_NODE:
+        case REMAINDER_NODE:
+            if(y == 0) { panic("Division by zero in a constant!"); }
+            if(is_signed_op && (int64_t) y == -1) {
+                // avoids the overflow of 'INT64_MIN / -1'
+                r = op == DIVISION_NODE? -x : 0;
+            } else if(is_signed_op) {
+                r = (uint64_t) (op == DIVISION_NODE
+                    ? (int64_t) x / (int64_t) y : (int64_t) x % (int64_t) y);
+            } else {
+                r = op == DIVISION_NODE? x / y : x % y;
+            }
+            break;
+        case BITWISE_AND_NODE: r = x & y; break;
+        case BITWISE_OR_NODE: r = x | y; break;
+        case BITWISE_XOR_NODE: r = x ^ y; break;
+        case LEFT_SHIFT_NODE:
+        case RIGHT_SHIFT_NODE:
+            if(y >= integer_bits(operand_type) && y >= 32) {
+                panic("Shift by the width of the type or more in a constant!");
+            }
+            if(op == LEFT_SHIFT_NODE) { r = x << y; }
+            else if(is_signed_op) { r = (uint64_t) ((int64_t) x >> y); }
+            else { r = x >> y; }
+            break;
+        default:
+            panic("UNHANDLED INTEGER OPERATION!");
+    }
+    return integer_value(wrap_integer(r, type));
+}
+
+static IrConstantValue evaluate_conversion(
+    IrConstantValue x, Node* from, Node* to
+) {
+    bool to_integer = ir_type_is_integer(to);
+    bool to_float = ir_type_is_float(to);
+    bool to_boolean = ir_type_is_core(to, "bool");
+    switch(x.type) {
+        case IR_CONSTANT_INTEGER: {
+            if(to_integer) { return integer_value(wrap_integer(x.value.integer, to)); }
+            double f = is_signed(from)
+                ? (double) (int64_t) x.value.integer
+                : (double) x.value.integer;
+            if(to_float) { return float_value(round_float(f, to)); }
+            if(to_boolean) { return boolean_value(x.value.integer != 0); }
+            break;
+        }
+        case IR_CONSTANT_FLOAT: {
+            double f = x.value.floating;
+            if(to_float) { return float_value(round_float(f, to)); }
+            if(!to_integer) { break; }
+            // the truncated value needs to fit the type
+            bool fits = is_signed(to)
+                ? f > -9223372036854775809.0 && f < 9223372036854775808.0
+                : f > -1.0 && f < 18446744073709551616.0;
+            if(!fits) { panic("Converted float does not fit the integer!"); }
+            uint64_t i = is_signed(to)? (uint64_t) (int64_t) f : (uint64_t) f;
+            if(wrap_integer(i, to) != i) {
+                panic("Converted float does not fit the integer!");
+            }
+            return integer_value(i);
+        }
+        case IR_CONSTANT_BOOLEAN:
+            if(to_boolean) { return x; }
+            if(to_integer) { return integer_value(x.value.boolean); }
+            break;
+        default:
+            if(template_arg_eq(from, to)) { return x; }
+            break;
+    }
+    panic("Conversion can not be evaluated at compile time!");
+}
+
+static IrConstantValue evaluate_function(
+    Evaluator* e, IrFunction* f, IrConstantValue* argv
+);
+
+static void evaluate_instruction(
+    Evaluator* e, Frame* frame, IrInstruction* i
+) {
+    IrConstantValue result;
+    switch(i->type) {
+        case IR_UNARY:
+            result = evaluate_unary(
+                i->value.unary.op, evaluate_value(e, frame, &i->value.unary.x),
+                frame->f->locals[i->dest].type
+            );
+            break;
+        case IR_BINARY:
+            result = evaluate_binary(
+                i->value.binary.op,
+                evaluate_value(e, frame, &i->value.binary.a),
+                evaluate_value(e, frame, &i->value.binary.b),
+                i->value.binary.a.data_type, frame->f->locals[i->dest].type
+            );
+            break;
+        case IR_CONVERT:
+            result = evaluate_conversion(
+                evaluate_value(e, frame, &i->value.convert.x),
+                i->value.convert.x.data_type, i->value.convert.to
+            );
+            break;
+        case IR_LOAD: {
+            IrConstantValue* from = evaluate_place(
+                e, frame, &i->value.load.from, false
+            );
+            if(from->type == IR_CONSTANT_NONE) {
+                panic("LOCAL USED BEFORE IT WAS ASSIGNED!");
+            }
+            result = copy_value(e, *from);
+            break;
+        }
+        case IR_STORE: {
+            IrConstantValue value = evaluate_value(
+                e, frame, &i->value.store.value
+            );
+            *evaluate_place(e, frame, &i->value.store.to, true) = value;
+            return;
+        }
+        case IR_CALL: {
+            if(i->value.call.is_external) {
+                panic("Constants can only call Nino functions!");
+            }
+            IrFunction* called = ir_program_lookup(
+                e->program, i->value.call.path, i->value.call.variant
+            );
+            size_t argc = i->value.call.argc;
+            IrConstantValue argv[argc];
+            for(size_t argi = 0; argi < argc; argi += 1) {
+                argv[argi] = evaluate_value(
+                    e, frame, i->value.call.argv + argi
+                );
+            }
+            result = evaluate_function(e, called, argv);
+            break;
+        }
+        case IR_RECORD:
+        case IR_ARRAY: {
+            bool is_record = i->type == IR_RECORD;
+            Node* type = is_record? i->value.record.type : i->value.array.type;
+            result = zero_value(e, type);
+            size_t argc = is_record? i->value.record.argc : i->value.array.valuec;
+            IrValue* argv = is_record? i->value.record.argv : i->value.array.valuev;
+            for(size_t argi = 0; argi < argc; argi += 1) {
+                result.value.aggregate.values[argi] = evaluate_value(
+                    e, frame, argv + argi
+                );
+            }
+            break;
+        }
+        case IR_PARALLEL:
+            panic("Parallel loops can not be used in constants!");
+        case IR_AWAIT:
+        case IR_YIELD:
+        case IR_TASK:
+            panic("Async functions can not be used in constants!");
+        default:
+            panic("Pointers can not be used in constants!");
+    }
+    if(i->has_dest) { frame->locals[i->dest] = result; }
+}
+
+static IrConstantValue evaluate_function(
+    Evaluator* e, IrFunction* f, IrConstantValue* argv
+) {
+    e->depth += 1;
+    if(e->depth > MAX_DEPTH) {
+        panic("Constant evaluation recursed too deeply!");
+    }
+    Frame frame = (Frame) {
+        .f = f,
+        .locals = (IrConstantValue*) calloc(
+            f->local_count, sizeof(IrConstantValue)
+        )
+    };
+    for(size_t argi = 0; argi < f->argc; argi += 1) {
+        frame.locals[argi] = argv[argi];
+    }
+    size_t block = 0;
+    for(;;) {
+        IrBlock* b = f->blocks + block;
+        for(size_t ii = 0; ii < b->instruction_count; ii += 1) {
+            e->steps += 1;
+            if(e->steps > MAX_STEPS) {
+                panic("Evaluation of a constant does not finish!");
+            }
+            evaluate_instruction(e, &frame, b->instructions + ii);
+        }
+        IrTerminator* t = &b->terminator;
+        switch(t->type) {
+            case IR_JUMP:
+                block = t->value.jump.to;
+                continue;
+            case IR_BRANCH: {
+                IrConstantValue condition = evaluate_value(
+                    e, &frame, &t->value.branch.condition
+                );
+                block = condition.value.boolean
+                    ? t->value.branch.if_true : t->value.branch.if_false;
+                continue;
+            }
+            case IR_SWITCH: {
+                IrValue* value = &t->value.switch_on.value;
+                IrConstantValue x = evaluate_value(e, &frame, value);
+                uint64_t v = x.type == IR_CONSTANT_BOOLEAN
+                    ? x.value.boolean : x.value.integer;
+                bool is_signed_value = is_signed(value->data_type);
+                block = t->value.switch_on.otherwise;
+                for(size_t ci = 0; ci < t->value.switch_on.casec; ci += 1) {
+                    IrSwitchCase* c = t->value.switch_on.casev + ci;
+                    bool matches = is_signed_value
+                        ? (int64_t) v >= (int64_t) c->low
+                            && (int64_t) v <= (int64_t) c->high
+                        : v >= c->low && v <= c->high;
+                    if(matches) { block = c->to; break; }
+                }
+                continue;
+            }
+            case IR_RETURN: {
+                IrConstantValue result = (IrConstantValue) {
+                    .type = IR_CONSTANT_NONE
+                };
+                if(t->value.return_value.has_value) {
+                    result = evaluate_value(
+                        e, &frame, &t->value.return_value.value
+                    );
+                }
+                free(frame.locals);
+                e->depth -= 1;
+                return result;
+            }
+            case IR_TRAP:
+                panic("Index out of bounds!");
+            default:
+                panic("Function evaluated for a constant does not return!");
+        }
+    }
+}
+
+static void evaluate_constant(Evaluator* e, IrConstant* c) {
+    if(c->is_evaluated) { return; }
+    size_t ci = c - e->program->constants;
+    if(e->evaluating[ci]) { panic("Constant depends on itself!"); }
+    e->evaluating[ci] = true;
+    c->value = evaluate_function(e, &c->initializer, NULL);
+    if(c->value.type == IR_CONSTANT_NONE) {
+        panic("Constants need a value!");
+    }
+    c->is_evaluated = true;
+    e->evaluating[ci] = false;
+}
+
+void evaluate_constants(IrProgram* p, SymbolTable* symbols, Arena* arena) {
+    Evaluator e = (Evaluator) {
+        .program = p,
+        .symbols = symbols,
+        .arena = arena,
+        .steps = 0,
+        .depth = 0,
+        .evaluating = (bool*) calloc(p->constant_count, sizeof(bool))
+    };
+    for(size_t ci = 0; ci < p->constant_count; ci += 1) {
+        // each constant gets its own budget, shared with the constants it
+        // evaluates on the way
+        e.steps = 0;
+        evaluate_constant(&e, p->constants + ci);
+    }
+    free(e.evaluating);
+}
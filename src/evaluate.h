@@ -0,0 +1,8 @@
+#pragma once
+#include "ir.h"
+
+
+// computes the values of all constants and the initial values of globals by
+// interpreting the (unoptimized) IR of their initializers and of the
+// functions they call
+void evaluate_constants(IrProgram* p, SymbolTable* symbols, Arena* arena);
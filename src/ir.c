@@ -0,0 +1,2787 @@
+
+#include <stdio.h>
+#include "ir.h"
+
+
+static Node* alloc_node(Node n, Arena* arena) {
+    Node* r = (Node*) arena_alloc(arena, sizeof(Node));
+    *r = n;
+    return r;
+}
+
+#define ALLOC_NODE(nv) alloc_node((nv), l->arena)
+
+
+bool ir_type_is_core(Node* type, const char* name) {
+    if(type->type != NAMESPACE_ACCESS_NODE) { return false; }
+    if(type->value.namespace_access.path.length != 1) { return false; }
+    return string_eq(
+        type->value.namespace_access.path.elements[0], string_wrap_nt(name)
+    );
+}
+
+bool ir_type_is_unit(Node* type) {
+    return ir_type_is_core(type, "unit");
+}
+
+bool ir_type_is_integer(Node* type) {
+    return ir_type_is_core(type, "u8") || ir_type_is_core(type, "u16")
+        || ir_type_is_core(type, "u32") || ir_type_is_core(type, "u64")
+        || ir_type_is_core(type, "usize")
+        || ir_type_is_core(type, "s8") || ir_type_is_core(type, "s16")
+        || ir_type_is_core(type, "s32") || ir_type_is_core(type, "s64")
+        || ir_type_is_core(type, "ssize");
+}
+
+bool ir_type_is_float(Node* type) {
+    return ir_type_is_core(type, "f32") || ir_type_is_core(type, "f64");
+}
+
+size_t ir_array_length(Node* array_type) {
+    if(array_type->value.array_type.length->type != INTEGER_LITERAL_NODE) {
+        panic("Array length is not a number!");
+    }
+    return (size_t) integer_literal_value(array_type->value.array_type.length);
+}
+
+// 'atomic[T]'
+bool ir_type_is_atomic(Node* type) {
+    return ir_type_is_core(type, "atomic")
+        && type->value.namespace_access.template_argc == 1;
+}
+
+// 'soa[R]', the rows of records 'R' stored as one slice per member
+bool ir_type_is_soa(Node* type) {
+    return ir_type_is_core(type, "soa")
+        && type->value.namespace_access.template_argc == 1;
+}
+
+// 'task', a started async function that is not awaited
+bool ir_type_is_task(Node* type) {
+    return ir_type_is_core(type, "task")
+        && type->value.namespace_access.template_argc == 0;
+}
+
+static bool is_vector_element(String name) {
+    const char* elements[] = {
+        "u8", "u16", "u32", "u64", "s8", "s16", "s32", "s64", "f32", "f64",
+        NULL
+    };
+    for(size_t ei = 0; elements[ei] != NULL; ei += 1) {
+        if(string_eq(name, string_wrap_nt(elements[ei]))) { return true; }
+    }
+    return false;
+}
+
+// vector types are named after their lane count and element type, like
+// 'v4f32' or 'v16u8'
+static bool vector_parts(Node* type, size_t* lanes, String* element) {
+    if(type->type != NAMESPACE_ACCESS_NODE) { return false; }
+    if(type->value.namespace_access.path.length != 1) { return false; }
+    String name = type->value.namespace_access.path.elements[0];
+    if(name.length < 2 || string_char_at(name, 0) != 'v') { return false; }
+    size_t end = 1;
+    size_t count = 0;
+    while(end < name.length && is_digit(string_char_at(name, end))) {
+        count = count * 10 + (string_char_at(name, end) - '0');
+        end += 1;
+    }
+    bool is_power_of_two = count >= 2 && (count & (count - 1)) == 0;
+    if(!is_power_of_two) { return false; }
+    String element_name = string_slice(name, end, name.length);
+    if(!is_vector_element(element_name)) { return false; }
+    if(lanes != NULL) { *lanes = count; }
+    if(element != NULL) { *element = element_name; }
+    return true;
+}
+
+bool ir_type_is_vector(Node* type) {
+    return vector_parts(type, NULL, NULL);
+}
+
+size_t ir_vector_lanes(Node* vector_type) {
+    size_t lanes;
+    if(!vector_parts(vector_type, &lanes, NULL)) { panic("Not a vector!"); }
+    return lanes;
+}
+
+String ir_vector_element(Node* vector_type) {
+    String element;
+    if(!vector_parts(vector_type, NULL, &element)) { panic("Not a vector!"); }
+    return element;
+}
+
+size_t ir_union_niche(Node* tagged_union) {
+    size_t casec = tagged_union->value.tagged_union.casec;
+    if(casec != 2) { return casec; }
+    Node* casetypev = tagged_union->value.tagged_union.casetypev;
+    for(size_t casei = 0; casei < casec; casei += 1) {
+        if(casetypev[casei].type == POINTER_TYPE_NODE
+            && ir_type_is_unit(casetypev + (1 - casei))) { return casei; }
+    }
+    return casec;
+}
+
+size_t ir_union_tag_bits(Node* tagged_union) {
+    size_t casec = tagged_union->value.tagged_union.casec;
+    if(casec <= 256) { return 8; }
+    if(casec <= 65536) { return 16; }
+    return 32;
+}
+
+
+// external functions are only trusted to be free of side effects if they
+// are declared as such
+IrPurity ir_external_purity(Node* external_function) {
+    Attributes* attributes = &external_function->value.external_function
+        .attributes;
+    if(attributes_find(attributes, "const") != NULL) { return IR_CONST; }
+    if(attributes_find(attributes, "pure") != NULL) { return IR_PURE; }
+    return IR_IMPURE;
+}
+
+
+bool ir_value_eq(IrValue* a, IrValue* b) {
+    if(a->type != b->type) { return false; }
+    switch(a->type) {
+        case IR_VALUE_NONE:
+            return true;
+        case IR_VALUE_LOCAL:
+            return a->value.local == b->value.local;
+        case IR_VALUE_INTEGER:
+        case IR_VALUE_FLOAT:
+        case IR_VALUE_STRING:
+        case IR_VALUE_BOOLEAN:
+            return string_eq(a->value.literal, b->value.literal)
+                && template_arg_eq(a->data_type, b->data_type);
+        case IR_VALUE_SIZE_OF:
+            return template_arg_eq(a->value.size_of, b->value.size_of);
+    }
+    return false;
+}
+
+static bool namespace_eq(Namespace a, Namespace b) {
+    if(a.length != b.length) { return false; }
+    for(size_t elementi = 0; elementi < a.length; elementi += 1) {
+        if(!string_eq(a.elements[elementi], b.elements[elementi])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ir_place_eq(IrPlace* a, IrPlace* b) {
+    if(a->type != b->type) { return false; }
+    switch(a->type) {
+        case IR_PLACE_LOCAL:
+            if(a->base.local != b->base.local) { return false; }
+            break;
+        case IR_PLACE_DEREF:
+            if(!ir_value_eq(&a->base.pointer, &b->base.pointer)) {
+                return false;
+            }
+            break;
+        case IR_PLACE_CONSTANT:
+            if(!namespace_eq(a->base.constant, b->base.constant)) {
+                return false;
+            }
+            break;
+        case IR_PLACE_GLOBAL:
+            if(!namespace_eq(a->base.global, b->base.global)) {
+                return false;
+            }
+            break;
+    }
+    if(a->projectionc != b->projectionc) { return false; }
+    for(size_t pi = 0; pi < a->projectionc; pi += 1) {
+        IrProjection* pa = a->projectionv + pi;
+        IrProjection* pb = b->projectionv + pi;
+        if(pa->type != pb->type) { return false; }
+        switch(pa->type) {
+            case IR_PROJECTION_MEMBER:
+                if(!string_eq(pa->member, pb->member)) { return false; }
+                break;
+            case IR_PROJECTION_INDEX:
+            case IR_PROJECTION_SLICE_INDEX:
+            case IR_PROJECTION_LANE:
+                if(!ir_value_eq(&pa->index, &pb->index)) { return false; }
+                break;
+        }
+    }
+    return true;
+}
+
+bool ir_place_is_indirect(IrPlace* p) {
+    if(p->type == IR_PLACE_DEREF || p->type == IR_PLACE_GLOBAL) {
+        return true;
+    }
+    for(size_t pi = 0; pi < p->projectionc; pi += 1) {
+        if(p->projectionv[pi].type == IR_PROJECTION_SLICE_INDEX) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void visit_value(IrValue* value, IrVisitor* v) {
+    if(v->visit_value != NULL) { v->visit_value(value, v->data); }
+}
+
+static void visit_place(IrPlace* place, IrVisitor* v) {
+    if(v->visit_place != NULL) { v->visit_place(place, v->data); }
+    if(place->type == IR_PLACE_DEREF) { visit_value(&place->base.pointer, v); }
+    for(size_t pi = 0; pi < place->projectionc; pi += 1) {
+        IrProjection* projection = place->projectionv + pi;
+        if(projection->type != IR_PROJECTION_MEMBER) {
+            visit_value(&projection->index, v);
+        }
+    }
+}
+
+void ir_visit_instruction(IrInstruction* i, IrVisitor* v) {
+    switch(i->type) {
+        case IR_UNARY:
+            visit_value(&i->value.unary.x, v);
+            break;
+        case IR_BINARY:
+            visit_value(&i->value.binary.a, v);
+            visit_value(&i->value.binary.b, v);
+            break;
+        case IR_CONVERT:
+            visit_value(&i->value.convert.x, v);
+            break;
+        case IR_LOAD:
+            visit_place(&i->value.load.from, v);
+            break;
+        case IR_STORE:
+            visit_place(&i->value.store.to, v);
+            visit_value(&i->value.store.value, v);
+            break;
+        case IR_ADDRESS_OF:
+            visit_place(&i->value.address_of.of, v);
+            break;
+        case IR_CALL:
+            for(size_t argi = 0; argi < i->value.call.argc; argi += 1) {
+                visit_value(i->value.call.argv + argi, v);
+            }
+            break;
+        case IR_RECORD:
+            for(size_t argi = 0; argi < i->value.record.argc; argi += 1) {
+                visit_value(i->value.record.argv + argi, v);
+            }
+            break;
+        case IR_ARRAY:
+            for(size_t vi = 0; vi < i->value.array.valuec; vi += 1) {
+                visit_value(i->value.array.valuev + vi, v);
+            }
+            break;
+        case IR_SLICE:
+            visit_value(&i->value.slice.data, v);
+            visit_value(&i->value.slice.start, v);
+            visit_value(&i->value.slice.end, v);
+            break;
+        case IR_PARALLEL:
+            visit_value(&i->value.parallel.start, v);
+            visit_value(&i->value.parallel.end, v);
+            for(size_t ci = 0; ci < i->value.parallel.capturec; ci += 1) {
+                visit_value(i->value.parallel.capturev + ci, v);
+            }
+            break;
+        case IR_AWAIT:
+        case IR_TASK:
+            for(size_t argi = 0; argi < i->value.coroutine.argc; argi += 1) {
+                visit_value(i->value.coroutine.argv + argi, v);
+            }
+            break;
+        case IR_YIELD:
+            break;
+    }
+}
+
+void ir_visit_terminator(IrTerminator* t, IrVisitor* v) {
+    switch(t->type) {
+        case IR_BRANCH:
+            visit_value(&t->value.branch.condition, v);
+            break;
+        case IR_SWITCH:
+            visit_value(&t->value.switch_on.value, v);
+            break;
+        case IR_RETURN:
+            if(t->value.return_value.has_value) {
+                visit_value(&t->value.return_value.value, v);
+            }
+            break;
+    }
+}
+
+
+size_t ir_add_local(IrFunction* f, IrLocal local) {
+    if(f->local_count + 1 > f->locals_bsize) {
+        f->locals_bsize *= 2;
+        f->locals = (IrLocal*) realloc(
+            f->locals, sizeof(IrLocal) * f->locals_bsize
+        );
+    }
+    f->locals[f->local_count] = local;
+    f->local_count += 1;
+    return f->local_count - 1;
+}
+
+size_t ir_add_block(IrFunction* f) {
+    if(f->block_count + 1 > f->blocks_bsize) {
+        f->blocks_bsize *= 2;
+        f->blocks = (IrBlock*) realloc(
+            f->blocks, sizeof(IrBlock) * f->blocks_bsize
+        );
+    }
+    IrBlock* b = f->blocks + f->block_count;
+    b->instructions_bsize = 4;
+    b->instruction_count = 0;
+    b->instructions = (IrInstruction*) malloc(
+        sizeof(IrInstruction) * b->instructions_bsize
+    );
+    b->terminator = (IrTerminator) { .type = IR_UNREACHABLE };
+    f->block_count += 1;
+    return f->block_count - 1;
+}
+
+void ir_block_push(IrBlock* b, IrInstruction instruction) {
+    if(b->instruction_count + 1 > b->instructions_bsize) {
+        b->instructions_bsize *= 2;
+        b->instructions = (IrInstruction*) realloc(
+            b->instructions, sizeof(IrInstruction) * b->instructions_bsize
+        );
+    }
+    b->instructions[b->instruction_count] = instruction;
+    b->instruction_count += 1;
+}
+
+static void ir_add_loop(IrFunction* f, IrLoop loop) {
+    if(f->loop_count + 1 > f->loops_bsize) {
+        f->loops_bsize *= 2;
+        f->loops = (IrLoop*) realloc(f->loops, sizeof(IrLoop) * f->loops_bsize);
+    }
+    f->loops[f->loop_count] = loop;
+    f->loop_count += 1;
+}
+
+void ir_function_free(IrFunction* f) {
+    for(size_t blocki = 0; blocki < f->block_count; blocki += 1) {
+        free(f->blocks[blocki].instructions);
+    }
+    free(f->blocks);
+    free(f->locals);
+    free(f->loops);
+}
+
+
+typedef struct ScopeEntry {
+    String name;
+    size_t local;
+} ScopeEntry;
+
+DEF_ARRAY_BUILDER(ScopeEntry)
+
+typedef struct {
+    IrFunction* f;
+    SymbolTable* symbols;
+    Arena* arena;
+    bool checked;
+    size_t current;
+    ArrayBuilder(ScopeEntry) scope;
+    // where the bodies of 'par' loops are added
+    IrProgram* program;
+    size_t parallel_count;
+} Lowerer;
+
+static Node* named_type(Lowerer* l, String name) {
+    String* element = (String*) arena_alloc(l->arena, sizeof(String));
+    *element = name;
+    return ALLOC_NODE(((Node) {
+        .type = NAMESPACE_ACCESS_NODE,
+        .value = { .namespace_access = {
+            .path = (Namespace) { .elements = element, .length = 1 },
+            .template_argc = 0,
+            .template_argv = NULL,
+            .variant = 0
+        } }
+    }));
+}
+
+static Node* core_type(Lowerer* l, const char* name) {
+    return named_type(l, string_wrap_nt(name));
+}
+
+// 'kind' is the first letter of the element type ('u', 's' or 'f')
+static Node* vector_type(Lowerer* l, size_t lanes, char kind, String bits) {
+    const char* format = "v%zu%c%.*s";
+    int bitc = (int) bits.length;
+    size_t length = snprintf(NULL, 0, format, lanes, kind, bitc, bits.data);
+    char* name = (char*) arena_alloc(l->arena, length + 1);
+    sprintf(name, format, lanes, kind, bitc, bits.data);
+    return named_type(l, string_wrap_nt_slice(name, length));
+}
+
+static Node* lane_type(Lowerer* l, Node* vector) {
+    return named_type(l, ir_vector_element(vector));
+}
+
+// comparing vectors gives a vector of all-ones or all-zeros signed integers
+// of the same width
+static Node* mask_type(Lowerer* l, Node* vector) {
+    String element = ir_vector_element(vector);
+    return vector_type(
+        l, ir_vector_lanes(vector), 's',
+        string_slice(element, 1, element.length)
+    );
+}
+
+static Node* pointer_type(Lowerer* l, Node* to) {
+    return ALLOC_NODE(((Node) {
+        .type = POINTER_TYPE_NODE,
+        .value = { .pointer_type = { .to = to } }
+    }));
+}
+
+// whether the place is reached through a '&const' pointer
+static bool place_is_read_only(IrPlace* p) {
+    if(p->type != IR_PLACE_DEREF) { return false; }
+    // slices point to memory of their own
+    for(size_t pi = 0; pi < p->projectionc; pi += 1) {
+        if(p->projectionv[pi].type == IR_PROJECTION_SLICE_INDEX) {
+            return false;
+        }
+    }
+    return p->base.pointer.data_type->value.pointer_type.is_const;
+}
+
+static Node* slice_type(Lowerer* l, Node* of) {
+    return ALLOC_NODE(((Node) {
+        .type = SLICE_TYPE_NODE,
+        .value = { .slice_type = { .of = of } }
+    }));
+}
+
+static size_t add_temporary(Lowerer* l, Node* type) {
+    // a restricted pointer may not be assigned a value based on another one
+    // declared in the same block
+    if(type->type == POINTER_TYPE_NODE
+        && type->value.pointer_type.is_restrict) {
+        Node* unrestricted = ALLOC_NODE(*type);
+        unrestricted->value.pointer_type.is_restrict = false;
+        type = unrestricted;
+    }
+    return ir_add_local(l->f, (IrLocal) {
+        .name = string_wrap_nt(""),
+        .is_temporary = true,
+        .is_argument = false,
+        .is_address_taken = false,
+        .type = type
+    });
+}
+
+static IrValue local_value(Lowerer* l, size_t local) {
+    return (IrValue) {
+        .type = IR_VALUE_LOCAL,
+        .data_type = l->f->locals[local].type,
+        .value = { .local = local }
+    };
+}
+
+static IrPlace local_place(Lowerer* l, size_t local) {
+    return (IrPlace) {
+        .type = IR_PLACE_LOCAL,
+        .data_type = l->f->locals[local].type,
+        .base = { .local = local },
+        .projectionc = 0,
+        .projectionv = NULL
+    };
+}
+
+static void emit(Lowerer* l, IrInstruction instruction) {
+    ir_block_push(l->f->blocks + l->current, instruction);
+}
+
+static void terminate(Lowerer* l, size_t block, IrTerminator terminator) {
+    l->f->blocks[block].terminator = terminator;
+}
+
+static IrTerminator jump_to(size_t block) {
+    return (IrTerminator) {
+        .type = IR_JUMP,
+        .value = { .jump = { .to = block } }
+    };
+}
+
+static IrTerminator branch_to(
+    IrValue condition, size_t if_true, size_t if_false
+) {
+    return (IrTerminator) {
+        .type = IR_BRANCH,
+        .value = { .branch = {
+            .condition = condition, .if_true = if_true, .if_false = if_false
+        } }
+    };
+}
+
+static bool lookup_local(Lowerer* l, String name, size_t* local) {
+    ScopeEntry* entries = (ScopeEntry*) l->scope.buffer;
+    for(size_t entryi = l->scope.length; entryi > 0; entryi -= 1) {
+        if(!string_eq(entries[entryi - 1].name, name)) { continue; }
+        *local = entries[entryi - 1].local;
+        return true;
+    }
+    return false;
+}
+
+static void store_local(Lowerer* l, size_t local, IrValue value) {
+    emit(l, (IrInstruction) {
+        .type = IR_STORE,
+        .has_dest = false,
+        .value = { .store = { .to = local_place(l, local), .value = value } }
+    });
+}
+
+static Node* symbol_variant(Lowerer* l, Node* access, Symbol** symbol_out) {
+    if(access->type != NAMESPACE_ACCESS_NODE) { return NULL; }
+    Symbol* s = s_table_lookup(l->symbols, access->value.namespace_access.path);
+    if(s == NULL) { return NULL; }
+    size_t variant = access->value.namespace_access.variant;
+    if(variant >= s->variant_count) { return NULL; }
+    if(symbol_out != NULL) { *symbol_out = s; }
+    return s->variants + variant;
+}
+
+static Node* member_type(Lowerer* l, Node* type, String name) {
+    // the members of a struct-of-arrays are the columns of the record
+    if(ir_type_is_soa(type)) {
+        return slice_type(l, member_type(
+            l, type->value.namespace_access.template_argv, name
+        ));
+    }
+    if(type->type == SLICE_TYPE_NODE) {
+        if(string_eq(name, string_wrap_nt("data"))) {
+            return pointer_type(l, type->value.slice_type.of);
+        }
+        if(string_eq(name, string_wrap_nt("length"))) {
+            return core_type(l, "usize");
+        }
+        panic("Accessed slice member does not exist!");
+    }
+    Node* record = symbol_variant(l, type, NULL);
+    if(record == NULL || record->type != RECORD_NODE) {
+        panic("Accessed member of a value that is not a record!");
+    }
+    for(size_t argi = 0; argi < record->value.record.argc; argi += 1) {
+        if(!string_eq(record->value.record.argnamev[argi], name)) { continue; }
+        return record->value.record.argtypev + argi;
+    }
+    panic("Accessed record member does not exist!");
+}
+
+
+static IrValue lower_value(Lowerer* l, Node* n, Node* expected);
+static IrValue lower_call(
+    Lowerer* l, Node* called, size_t argc, Node* argv, bool used
+);
+static IrValue lower_await(Lowerer* l, Node* n, bool used);
+static void lower_block(Lowerer* l, Block b);
+
+static bool is_literal(IrValue v) {
+    return v.type == IR_VALUE_INTEGER || v.type == IR_VALUE_FLOAT;
+}
+
+// gives an untyped number literal the type of the value it is used with,
+// or the type of its lanes if that is a vector
+static void infer_literal_type(Lowerer* l, IrValue* literal, IrValue other) {
+    if(!is_literal(*literal) || is_literal(other)) { return; }
+    Node* type = ir_type_is_vector(other.data_type)
+        ? lane_type(l, other.data_type) : other.data_type;
+    bool fits = ir_type_is_float(type)
+        || (literal->type == IR_VALUE_INTEGER && ir_type_is_integer(type));
+    if(fits) { literal->data_type = type; }
+}
+
+static size_t materialize(Lowerer* l, IrValue v) {
+    if(v.type == IR_VALUE_LOCAL) { return v.value.local; }
+    size_t temp = add_temporary(l, v.data_type);
+    store_local(l, temp, v);
+    return temp;
+}
+
+static void project(Lowerer* l, IrPlace* place, IrProjection projection) {
+    IrProjection* projectionv = (IrProjection*) arena_alloc(
+        l->arena, sizeof(IrProjection) * (place->projectionc + 1)
+    );
+    memcpy(
+        projectionv, place->projectionv,
+        sizeof(IrProjection) * place->projectionc
+    );
+    projectionv[place->projectionc] = projection;
+    place->projectionc += 1;
+    place->projectionv = projectionv;
+}
+
+static void project_member(Lowerer* l, IrPlace* place, String name) {
+    project(l, place, (IrProjection) {
+        .type = IR_PROJECTION_MEMBER,
+        .member = name
+    });
+    place->data_type = member_type(l, place->data_type, name);
+}
+
+static String size_string(Lowerer* l, size_t n) {
+    size_t digitc = snprintf(NULL, 0, "%zu", n);
+    char* digits = (char*) arena_alloc(l->arena, digitc + 1);
+    sprintf(digits, "%zu", n);
+    return string_wrap_nt_slice(digits, digitc);
+}
+
+static IrValue size_value(Lowerer* l, size_t n) {
+    return (IrValue) {
+        .type = IR_VALUE_INTEGER,
+        .data_type = core_type(l, "usize"),
+        .value = { .literal = size_string(l, n) }
+    };
+}
+
+static IrValue load_place(Lowerer* l, IrPlace place) {
+    size_t dest = add_temporary(l, place.data_type);
+    emit(l, (IrInstruction) {
+        .type = IR_LOAD,
+        .has_dest = true,
+        .dest = dest,
+        .value = { .load = { .from = place } }
+    });
+    return local_value(l, dest);
+}
+
+static size_t union_case(Node* tagged_union, String name) {
+    size_t casec = tagged_union->value.tagged_union.casec;
+    for(size_t casei = 0; casei < casec; casei += 1) {
+        String case_name = tagged_union->value.tagged_union.casenamev[casei];
+        if(string_eq(case_name, name)) { return casei; }
+    }
+    panic("Union case does not exist!");
+}
+
+static Node* union_tag_type(Lowerer* l, Node* tagged_union) {
+    switch(ir_union_tag_bits(tagged_union)) {
+        case 8: return core_type(l, "u8");
+        case 16: return core_type(l, "u16");
+        default: return core_type(l, "u32");
+    }
+}
+
+// the name of the C member holding the value of a union case
+static String union_case_member(Lowerer* l, Node* tagged_union, size_t casei) {
+    String name = tagged_union->value.tagged_union.casenamev[casei];
+    if(ir_union_niche(tagged_union) == casei) { return name; }
+    char* member = (char*) arena_alloc(l->arena, name.length + 5);
+    memcpy(member, "data.", 5);
+    memcpy(member + 5, name.data, name.length);
+    return string_wrap_nt_slice(member, name.length + 5);
+}
+
+// the value the tag of a union is switched on, which is whether the pointer
+// is not null for unions represented by a pointer
+static IrValue union_tag(Lowerer* l, IrPlace matched, Node* tagged_union) {
+    size_t niche = ir_union_niche(tagged_union);
+    if(niche == tagged_union->value.tagged_union.casec) {
+        project(l, &matched, (IrProjection) {
+            .type = IR_PROJECTION_MEMBER,
+            .member = string_wrap_nt("tag")
+        });
+        matched.data_type = union_tag_type(l, tagged_union);
+        return load_place(l, matched);
+    }
+    Node* pointer_type = tagged_union->value.tagged_union.casetypev + niche;
+    project(l, &matched, (IrProjection) {
+        .type = IR_PROJECTION_MEMBER,
+        .member = union_case_member(l, tagged_union, niche)
+    });
+    matched.data_type = pointer_type;
+    IrValue pointer = load_place(l, matched);
+    size_t dest = add_temporary(l, core_type(l, "bool"));
+    emit(l, (IrInstruction) {
+        .type = IR_BINARY,
+        .has_dest = true,
+        .dest = dest,
+        .value = { .binary = {
+            .op = NOT_EQUALS_NODE,
+            .a = pointer,
+            .b = (IrValue) {
+                .type = IR_VALUE_INTEGER,
+                .data_type = pointer_type,
+                .value = { .literal = string_wrap_nt("0") }
+            }
+        } }
+    });
+    return local_value(l, dest);
+}
+
+// 'Shape circle 1.5' or 'Shape none' for a case without a value
+static IrValue lower_union_construction(
+    Lowerer* l, Node* called, Node* tagged_union, size_t argc, Node* argv
+) {
+    if(argc == 0) { panic("Union construction needs a case!"); }
+    String name;
+    if(argv->type == VARIABLE_NODE) {
+        name = argv->value.variable.name;
+    } else if(argv->type == NAMESPACE_ACCESS_NODE
+        && argv->value.namespace_access.template_argc == 0) {
+        // case names that are also the names of symbols have been expanded
+        Namespace path = argv->value.namespace_access.path;
+        name = path.elements[path.length - 1];
+    } else {
+        panic("Union construction needs a case!");
+    }
+    size_t casei = union_case(tagged_union, name);
+    Node* case_type = tagged_union->value.tagged_union.casetypev + casei;
+    bool has_value = !ir_type_is_unit(case_type);
+    if(argc != (has_value? 2 : 1)) { panic("Invalid argument count!"); }
+    String* namev = (String*) arena_alloc(l->arena, sizeof(String) * 2);
+    IrValue* valuev = (IrValue*) arena_alloc(l->arena, sizeof(IrValue) * 2);
+    size_t valuec = 0;
+    size_t niche = ir_union_niche(tagged_union);
+    if(niche < tagged_union->value.tagged_union.casec) {
+        namev[0] = union_case_member(l, tagged_union, niche);
+        valuev[0] = has_value? lower_value(l, argv + 1, case_type) : (IrValue) {
+            .type = IR_VALUE_INTEGER,
+            .data_type = tagged_union->value.tagged_union.casetypev + niche,
+            .value = { .literal = string_wrap_nt("0") }
+        };
+        valuec = 1;
+    } else {
+        namev[0] = string_wrap_nt("tag");
+        valuev[0] = (IrValue) {
+            .type = IR_VALUE_INTEGER,
+            .data_type = union_tag_type(l, tagged_union),
+            .value = { .literal = size_string(l, casei) }
+        };
+        valuec = 1;
+        if(has_value) {
+            namev[1] = union_case_member(l, tagged_union, casei);
+            valuev[1] = lower_value(l, argv + 1, case_type);
+            valuec = 2;
+        }
+    }
+    size_t dest = add_temporary(l, called);
+    emit(l, (IrInstruction) {
+        .type = IR_RECORD,
+        .has_dest = true,
+        .dest = dest,
+        .value = { .record = {
+            .type = called, .argc = valuec, .argnamev = namev, .argv = valuev
+        } }
+    });
+    return local_value(l, dest);
+}
+
+// the number of elements of an array or slice place
+static IrValue element_count(Lowerer* l, IrPlace place) {
+    if(place.data_type->type == ARRAY_TYPE_NODE) {
+        return size_value(l, ir_array_length(place.data_type));
+    }
+    if(ir_type_is_vector(place.data_type)) {
+        return size_value(l, ir_vector_lanes(place.data_type));
+    }
+    project(l, &place, (IrProjection) {
+        .type = IR_PROJECTION_MEMBER,
+        .member = string_wrap_nt("length")
+    });
+    place.data_type = core_type(l, "usize");
+    return load_place(l, place);
+}
+
+static uint64_t literal_value(IrValue v) {
+    STRING_AS_NT(v.value.literal, digits);
+    return strtoull(digits, NULL, 10);
+}
+
+// traps unless 'index' is less than 'length' (or equal to it if
+// 'inclusive'), checks of constants are done at compile time
+static void check_bounds(
+    Lowerer* l, IrValue index, IrValue length, bool inclusive
+) {
+    if(index.type == IR_VALUE_INTEGER && length.type == IR_VALUE_INTEGER) {
+        uint64_t i = literal_value(index);
+        uint64_t n = literal_value(length);
+        if(inclusive? i > n : i >= n) { panic("Index out of bounds!"); }
+        return;
+    }
+    size_t in_bounds = add_temporary(l, core_type(l, "bool"));
+    emit(l, (IrInstruction) {
+        .type = IR_BINARY,
+        .has_dest = true,
+        .dest = in_bounds,
+        .value = { .binary = {
+            .op = inclusive? LESS_THAN_EQUAL_NODE : LESS_THAN_NODE,
+            .a = index, .b = length
+        } }
+    });
+    size_t fail = ir_add_block(l->f);
+    terminate(l, fail, (IrTerminator) { .type = IR_TRAP });
+    size_t next = ir_add_block(l->f);
+    terminate(l, l->current, branch_to(
+        local_value(l, in_bounds), next, fail
+    ));
+    l->current = next;
+}
+
+static IrPlace lower_place(Lowerer* l, Node* n) {
+    switch(n->type) {
+        case VARIABLE_NODE: {
+            size_t local;
+            if(!lookup_local(l, n->value.variable.name, &local)) {
+                panic("Unknown variable!");
+            }
+            return local_place(l, local);
+        }
+        case DEREF_NODE: {
+            IrValue pointer = lower_value(l, n->value.deref.x, NULL);
+            if(pointer.data_type->type != POINTER_TYPE_NODE) {
+                panic("Dereferenced value is not a pointer!");
+            }
+            return (IrPlace) {
+                .type = IR_PLACE_DEREF,
+                .data_type = pointer.data_type->value.pointer_type.to,
+                .base = { .pointer = pointer },
+                .projectionc = 0,
+                .projectionv = NULL
+            };
+        }
+        case MEMBER_ACCESS_NODE: {
+            IrPlace place = lower_place(l, n->value.member_access.x);
+            project_member(l, &place, n->value.member_access.name);
+            return place;
+        }
+        case INDEX_NODE: {
+            IrPlace place = lower_place(l, n->value.index.x);
+            Node* indexed = place.data_type;
+            IrProjectionType projection;
+            Node* element;
+            if(indexed->type == ARRAY_TYPE_NODE) {
+                projection = IR_PROJECTION_INDEX;
+                element = indexed->value.array_type.of;
+            } else if(indexed->type == SLICE_TYPE_NODE) {
+                projection = IR_PROJECTION_SLICE_INDEX;
+                element = indexed->value.slice_type.of;
+            } else if(ir_type_is_vector(indexed)) {
+                projection = IR_PROJECTION_LANE;
+                element = lane_type(l, indexed);
+            } else {
+                panic("Indexed value is not an array, slice or vector!");
+            }
+            IrValue index = lower_value(
+                l, n->value.index.index, core_type(l, "usize")
+            );
+            if(l->checked) {
+                check_bounds(l, index, element_count(l, place), false);
+            }
+            project(l, &place, (IrProjection) {
+                .type = projection,
+                .index = index
+            });
+            place.data_type = element;
+            return place;
+        }
+        case NAMESPACE_ACCESS_NODE: {
+            Symbol* s;
+            Node* constant = symbol_variant(l, n, &s);
+            if(constant != NULL && constant->type == CONSTANT_NODE) {
+                return (IrPlace) {
+                    .type = IR_PLACE_CONSTANT,
+                    .data_type = constant->value.constant.type,
+                    .base = { .constant = s->path },
+                    .projectionc = 0,
+                    .projectionv = NULL
+                };
+            }
+            if(constant != NULL && constant->type == GLOBAL_NODE) {
+                return (IrPlace) {
+                    .type = IR_PLACE_GLOBAL,
+                    .data_type = constant->value.global.type,
+                    .base = { .global = s->path },
+                    .projectionc = 0,
+                    .projectionv = NULL
+                };
+            }
+            // otherwise a call
+        }
+        default: {
+            IrValue value = lower_value(l, n, NULL);
+            return local_place(l, materialize(l, value));
+        }
+    }
+}
+
+static IrValue lower_short_circuit(
+    Lowerer* l, Node* a, Node* b, bool is_and
+) {
+    Node* bool_type = core_type(l, "bool");
+    size_t result = add_temporary(l, bool_type);
+    store_local(l, result, lower_value(l, a, bool_type));
+    size_t from = l->current;
+    size_t rhs = ir_add_block(l->f);
+    l->current = rhs;
+    store_local(l, result, lower_value(l, b, bool_type));
+    size_t rhs_end = l->current;
+    size_t end = ir_add_block(l->f);
+    terminate(l, rhs_end, jump_to(end));
+    terminate(l, from, branch_to(
+        local_value(l, result), is_and? rhs : end, is_and? end : rhs
+    ));
+    l->current = end;
+    return local_value(l, result);
+}
+
+static IrValue lower_binary(
+    Lowerer* l, NodeType op, Node* a, Node* b, Node* expected
+) {
+    bool is_comparison = op == EQUALS_NODE || op == NOT_EQUALS_NODE
+        || op == LESS_THAN_NODE || op == GREATER_THAN_NODE
+        || op == LESS_THAN_EQUAL_NODE || op == GREATER_THAN_EQUAL_NODE;
+    bool is_shift = op == LEFT_SHIFT_NODE || op == RIGHT_SHIFT_NODE;
+    IrValue av = lower_value(l, a, is_comparison? NULL : expected);
+    IrValue bv = lower_value(
+        l, b, is_comparison || is_shift? NULL : expected
+    );
+    if(!is_shift) {
+        infer_literal_type(l, &av, bv);
+        infer_literal_type(l, &bv, av);
+    }
+    // a scalar operand is applied to every lane of a vector
+    Node* value_type = !is_shift && ir_type_is_vector(bv.data_type)
+        ? bv.data_type : av.data_type;
+    Node* result_type = value_type;
+    if(is_comparison) {
+        result_type = ir_type_is_vector(value_type)
+            ? mask_type(l, value_type) : core_type(l, "bool");
+    }
+    size_t dest = add_temporary(l, result_type);
+    emit(l, (IrInstruction) {
+        .type = IR_BINARY,
+        .has_dest = true,
+        .dest = dest,
+        .value = { .binary = { .op = op, .a = av, .b = bv } }
+    });
+    return local_value(l, dest);
+}
+
+static IrValue lower_unary(Lowerer* l, NodeType op, Node* x, Node* expected) {
+    bool is_logical = op == LOGICAL_NOT_NODE;
+    IrValue xv = lower_value(
+        l, x, is_logical? core_type(l, "bool") : expected
+    );
+    size_t dest = add_temporary(
+        l, is_logical? core_type(l, "bool") : xv.data_type
+    );
+    emit(l, (IrInstruction) {
+        .type = IR_UNARY,
+        .has_dest = true,
+        .dest = dest,
+        .value = { .unary = { .op = op, .x = xv } }
+    });
+    return local_value(l, dest);
+}
+
+static Node* array_type(Lowerer* l, size_t length, Node* of) {
+    Node* length_node = ALLOC_NODE(((Node) {
+        .type = INTEGER_LITERAL_NODE,
+        .value = { .integer_literal = { .value = size_string(l, length) } }
+    }));
+    return ALLOC_NODE(((Node) {
+        .type = ARRAY_TYPE_NODE,
+        .value = { .array_type = { .length = length_node, .of = of } }
+    }));
+}
+
+static IrValue lower_array_literal(Lowerer* l, Node* n, Node* expected) {
+    size_t valuec = n->value.array_literal.valuec;
+    bool is_vector = expected != NULL && ir_type_is_vector(expected);
+    // '[]' is also an empty struct-of-arrays
+    bool is_soa = expected != NULL && ir_type_is_soa(expected);
+    if(is_soa && valuec > 0) {
+        panic("Struct-of-arrays literals must be empty!");
+    }
+    Node* type = expected != NULL && (
+        expected->type == ARRAY_TYPE_NODE || is_vector || is_soa
+    )? expected : NULL;
+    Node* element_type = type == NULL || is_soa? NULL
+        : is_vector? lane_type(l, type) : type->value.array_type.of;
+    IrValue* valuev = (IrValue*) arena_alloc(
+        l->arena, sizeof(IrValue) * valuec
+    );
+    for(size_t valuei = 0; valuei < valuec; valuei += 1) {
+        valuev[valuei] = lower_value(
+            l, n->value.array_literal.valuev + valuei, element_type
+        );
+        // without an expected type the first element decides
+        if(element_type == NULL) { element_type = valuev[valuei].data_type; }
+    }
+    if(type == NULL) {
+        if(valuec == 0) { panic("Unable to infer the type of an array!"); }
+        type = array_type(l, valuec, element_type);
+    } else if(is_vector && valuec > ir_vector_lanes(type)) {
+        panic("Vector literal has more elements than the vector type!");
+    } else if(!is_vector && !is_soa && valuec > ir_array_length(type)) {
+        panic("Array literal has more elements than the array type!");
+    }
+    size_t dest = add_temporary(l, type);
+    emit(l, (IrInstruction) {
+        .type = IR_ARRAY,
+        .has_dest = true,
+        .dest = dest,
+        .value = { .array = {
+            .type = type, .valuec = valuec, .valuev = valuev
+        } }
+    });
+    return local_value(l, dest);
+}
+
+static IrValue lower_slice(Lowerer* l, Node* n) {
+    IrPlace place = lower_place(l, n->value.slice.x);
+    Node* sliced = place.data_type;
+    Node* element;
+    IrValue data;
+    if(sliced->type == SLICE_TYPE_NODE) {
+        element = sliced->value.slice_type.of;
+        IrPlace data_place = place;
+        project(l, &data_place, (IrProjection) {
+            .type = IR_PROJECTION_MEMBER,
+            .member = string_wrap_nt("data")
+        });
+        data_place.data_type = pointer_type(l, element);
+        data = load_place(l, data_place);
+    } else if(sliced->type == ARRAY_TYPE_NODE) {
+        element = sliced->value.array_type.of;
+        // the slice refers to the array itself
+        if(place.type == IR_PLACE_LOCAL) {
+            l->f->locals[place.base.local].is_address_taken = true;
+        }
+        if(place.type == IR_PLACE_CONSTANT) {
+            panic("Constants have no address!");
+        }
+        IrPlace first = place;
+        project(l, &first, (IrProjection) {
+            .type = IR_PROJECTION_INDEX,
+            .index = size_value(l, 0)
+        });
+        first.data_type = element;
+        size_t dest = add_temporary(l, pointer_type(l, element));
+        emit(l, (IrInstruction) {
+            .type = IR_ADDRESS_OF,
+            .has_dest = true,
+            .dest = dest,
+            .value = { .address_of = { .of = first } }
+        });
+        data = local_value(l, dest);
+    } else {
+        panic("Sliced value is not an array or slice!");
+    }
+    Node* usize = core_type(l, "usize");
+    IrValue start = n->value.slice.start == NULL? size_value(l, 0)
+        : lower_value(l, n->value.slice.start, usize);
+    IrValue end = n->value.slice.end == NULL? element_count(l, place)
+        : lower_value(l, n->value.slice.end, usize);
+    if(l->checked) {
+        check_bounds(l, end, element_count(l, place), true);
+        check_bounds(l, start, end, true);
+    }
+    size_t dest = add_temporary(l, slice_type(l, element));
+    emit(l, (IrInstruction) {
+        .type = IR_SLICE,
+        .has_dest = true,
+        .dest = dest,
+        .value = { .slice = {
+            .type = l->f->locals[dest].type,
+            .data = data, .start = start, .end = end
+        } }
+    });
+    return local_value(l, dest);
+}
+
+static IrValue lower_value(Lowerer* l, Node* n, Node* expected) {
+    switch(n->type) {
+        case UNIT_LITERAL_NODE:
+            return (IrValue) {
+                .type = IR_VALUE_NONE, .data_type = core_type(l, "unit")
+            };
+        case INTEGER_LITERAL_NODE:
+            return (IrValue) {
+                .type = IR_VALUE_INTEGER,
+                .data_type = expected != NULL && (ir_type_is_integer(expected)
+                    || ir_type_is_float(expected))
+                    ? expected : core_type(l, "s32"),
+                .value = { .literal = n->value.integer_literal.value }
+            };
+        case FLOAT_LITERAL_NODE:
+            return (IrValue) {
+                .type = IR_VALUE_FLOAT,
+                .data_type = expected != NULL && ir_type_is_float(expected)
+                    ? expected : core_type(l, "f64"),
+                .value = { .literal = n->value.float_literal.value }
+            };
+        case STRING_LITERAL_NODE: {
+            // the length of a literal is known, so it can become a slice
+            bool is_slice = expected != NULL
+                && expected->type == SLICE_TYPE_NODE
+                && ir_type_is_core(expected->value.slice_type.of, "u8");
+            return (IrValue) {
+                .type = IR_VALUE_STRING,
+                .data_type = is_slice
+                    ? expected : pointer_type(l, core_type(l, "u8")),
+                .value = { .literal = n->value.string_literal.value }
+            };
+        }
+        case BOOLEAN_LITERAL_NODE:
+            return (IrValue) {
+                .type = IR_VALUE_BOOLEAN,
+                .data_type = core_type(l, "bool"),
+                .value = { .literal = n->value.boolean_literal.value }
+            };
+        case SIZE_OF_NODE:
+            return (IrValue) {
+                .type = IR_VALUE_SIZE_OF,
+                .data_type = core_type(l, "usize"),
+                .value = { .size_of = n->value.size_of.t }
+            };
+        case VARIABLE_NODE: {
+            size_t local;
+            if(!lookup_local(l, n->value.variable.name, &local)) {
+                panic("Unknown variable!");
+            }
+            return local_value(l, local);
+        }
+        case DEREF_NODE:
+        case MEMBER_ACCESS_NODE:
+        case INDEX_NODE:
+            return load_place(l, lower_place(l, n));
+        case ADDRESS_OF_NODE: {
+            IrPlace place = lower_place(l, n->value.address_of.x);
+            if(place.type == IR_PLACE_LOCAL) {
+                l->f->locals[place.base.local].is_address_taken = true;
+            }
+            if(place.type == IR_PLACE_CONSTANT) {
+                panic("Constants have no address!");
+            }
+            Node* type = pointer_type(l, place.data_type);
+            type->value.pointer_type.is_const = place_is_read_only(&place);
+            size_t dest = add_temporary(l, type);
+            emit(l, (IrInstruction) {
+                .type = IR_ADDRESS_OF,
+                .has_dest = true,
+                .dest = dest,
+                .value = { .address_of = { .of = place } }
+            });
+            return local_value(l, dest);
+        }
+        case TYPE_CONVERSION_NODE: {
+            IrValue x = lower_value(l, n->value.type_conversion.x, NULL);
+            size_t dest = add_temporary(l, n->value.type_conversion.to);
+            emit(l, (IrInstruction) {
+                .type = IR_CONVERT,
+                .has_dest = true,
+                .dest = dest,
+                .value = { .convert = {
+                    .x = x, .to = n->value.type_conversion.to
+                } }
+            });
+            return local_value(l, dest);
+        }
+        #define LOWER_BINARY(tn, vn, a, b) case tn: \
+            return lower_binary(l, tn, n->value.vn.a, n->value.vn.b, expected);
+        LOWER_BINARY(ADDITION_NODE, addition, a, b)
+        LOWER_BINARY(SUBTRACTION_NODE, subtraction, a, b)
+        LOWER_BINARY(MULTIPLICATION_NODE, multiplication, a, b)
+        LOWER_BINARY(DIVISION_NODE, division, a, b)
+        LOWER_BINARY(REMAINDER_NODE, remainder, a, b)
+        LOWER_BINARY(BITWISE_AND_NODE, bitwise_and, a, b)
+        LOWER_BINARY(BITWISE_OR_NODE, bitwise_or, a, b)
+        LOWER_BINARY(BITWISE_XOR_NODE, bitwise_xor, a, b)
+        LOWER_BINARY(LEFT_SHIFT_NODE, left_shift, x, n)
+        LOWER_BINARY(RIGHT_SHIFT_NODE, right_shift, x, n)
+        LOWER_BINARY(EQUALS_NODE, equals, a, b)
+        LOWER_BINARY(NOT_EQUALS_NODE, not_equals, a, b)
+        LOWER_BINARY(LESS_THAN_NODE, less_than, a, b)
+        LOWER_BINARY(GREATER_THAN_NODE, greater_than, a, b)
+        LOWER_BINARY(LESS_THAN_EQUAL_NODE, less_than_equal, a, b)
+        LOWER_BINARY(GREATER_THAN_EQUAL_NODE, greater_than_equal, a, b)
+        case NEGATION_NODE:
+            return lower_unary(l, NEGATION_NODE, n->value.negation.x, expected);
+        case BITWISE_NOT_NODE:
+            return lower_unary(
+                l, BITWISE_NOT_NODE, n->value.bitwise_not.x, expected
+            );
+        case LOGICAL_NOT_NODE:
+            return lower_unary(
+                l, LOGICAL_NOT_NODE, n->value.logical_not.x, expected
+            );
+        case LOGICAL_AND_NODE:
+            return lower_short_circuit(
+                l, n->value.logical_and.a, n->value.logical_and.b, true
+            );
+        case LOGICAL_OR_NODE:
+            return lower_short_circuit(
+                l, n->value.logical_or.a, n->value.logical_or.b, false
+            );
+        case NAMESPACE_ACCESS_NODE: {
+            Node* global = symbol_variant(l, n, NULL);
+            if(global != NULL && (global->type == CONSTANT_NODE
+                || global->type == GLOBAL_NODE)) {
+                return load_place(l, lower_place(l, n));
+            }
+            return lower_call(l, n, 0, NULL, true);
+        }
+        case CALL_NODE:
+            return lower_call(
+                l, n->value.call.called, n->value.call.argc, n->value.call.argv,
+                true
+            );
+        case ARRAY_LITERAL_NODE:
+            return lower_array_literal(l, n, expected);
+        case SLICE_NODE:
+            return lower_slice(l, n);
+        case AWAIT_NODE:
+            return lower_await(l, n, true);
+    }
+    panic("UNHANDLED EXPRESSION NODE!");
+}
+
+static IrValue* lower_arguments(
+    Lowerer* l, size_t argc, Node* argv, size_t expected_argc, Node* typev
+) {
+    if(argc != expected_argc) { panic("Invalid argument count!"); }
+    IrValue* values = (IrValue*) arena_alloc(l->arena, sizeof(IrValue) * argc);
+    for(size_t argi = 0; argi < argc; argi += 1) {
+        values[argi] = lower_value(l, argv + argi, typev + argi);
+    }
+    return values;
+}
+
+static bool is_builtin(Node* called, const char* module, const char* name) {
+    if(called->type != NAMESPACE_ACCESS_NODE) { return false; }
+    Namespace path = called->value.namespace_access.path;
+    return path.length == 2
+        && string_eq(path.elements[0], string_wrap_nt(module))
+        && string_eq(path.elements[1], string_wrap_nt(name));
+}
+
+static IrValue emit_builtin(
+    Lowerer* l, Node* called, const char* builtin, IrPurity purity,
+    size_t argc, IrValue* argv, Node* return_type, bool used
+) {
+    IrInstruction call = (IrInstruction) {
+        .type = IR_CALL,
+        .has_dest = used && !ir_type_is_unit(return_type),
+        .value = { .call = {
+            .is_external = true,
+            .path = called->value.namespace_access.path,
+            .variant = 0,
+            .purity = purity,
+            .external_name = string_wrap_nt(builtin),
+            .argc = argc, .argv = argv
+        } }
+    };
+    if(!call.has_dest) {
+        emit(l, call);
+        return (IrValue) { .type = IR_VALUE_NONE, .data_type = return_type };
+    }
+    call.dest = add_temporary(l, return_type);
+    emit(l, call);
+    return local_value(l, call.dest);
+}
+
+// 'simd::shuffle a b i...' picks the lanes of a new vector by their index
+// in the lanes of 'a' followed by the lanes of 'b'
+static IrValue lower_shuffle(
+    Lowerer* l, Node* called, size_t argc, Node* argv, bool used
+) {
+    if(argc < 4) { panic("Invalid argument count!"); }
+    IrValue* values = (IrValue*) arena_alloc(l->arena, sizeof(IrValue) * argc);
+    values[0] = lower_value(l, argv, NULL);
+    Node* vector = values[0].data_type;
+    if(!ir_type_is_vector(vector)) { panic("Shuffled value is not a vector!"); }
+    values[1] = lower_value(l, argv + 1, vector);
+    size_t lanes = ir_vector_lanes(vector);
+    for(size_t argi = 2; argi < argc; argi += 1) {
+        if(argv[argi].type != INTEGER_LITERAL_NODE) {
+            panic("Shuffle indices must be integer literals!");
+        }
+        if(integer_literal_value(argv + argi) >= lanes * 2) {
+            panic("Shuffle index out of range!");
+        }
+        values[argi] = lower_value(l, argv + argi, NULL);
+    }
+    String element = ir_vector_element(vector);
+    Node* result = vector_type(
+        l, argc - 2, string_char_at(element, 0),
+        string_slice(element, 1, element.length)
+    );
+    if(!ir_type_is_vector(result)) {
+        panic("Shuffles must produce a power of two lanes!");
+    }
+    return emit_builtin(
+        l, called, "__builtin_shufflevector", IR_CONST, argc, values, result,
+        used
+    );
+}
+
+static const char* memory_orders[][2] = {
+    { "relaxed", "memory_order_relaxed" },
+    { "consume", "memory_order_consume" },
+    { "acquire", "memory_order_acquire" },
+    { "release", "memory_order_release" },
+    { "acq_rel", "memory_order_acq_rel" },
+    { "seq_cst", "memory_order_seq_cst" },
+    { NULL, NULL }
+};
+
+typedef enum {
+    ATOMIC_RETURNS_VALUE,
+    ATOMIC_RETURNS_BOOL,
+    ATOMIC_RETURNS_UNIT
+} AtomicReturn;
+
+typedef struct AtomicOperation {
+    const char* name;
+    const char* builtin;
+    // the atomic address, 'valuec' values and 'orderc' memory orders
+    size_t valuec;
+    size_t orderc;
+    AtomicReturn returns;
+} AtomicOperation;
+
+static const AtomicOperation atomic_operations[] = {
+    { "load", "atomic_load_explicit", 0, 1, ATOMIC_RETURNS_VALUE },
+    { "store", "atomic_store_explicit", 1, 1, ATOMIC_RETURNS_UNIT },
+    { "exchange", "atomic_exchange_explicit", 1, 1, ATOMIC_RETURNS_VALUE },
+    // the expected value is passed by address and updated on failure
+    {
+        "compare_exchange", "atomic_compare_exchange_strong_explicit",
+        2, 2, ATOMIC_RETURNS_BOOL
+    },
+    {
+        "compare_exchange_weak", "atomic_compare_exchange_weak_explicit",
+        2, 2, ATOMIC_RETURNS_BOOL
+    },
+    { "fetch_add", "atomic_fetch_add_explicit", 1, 1, ATOMIC_RETURNS_VALUE },
+    { "fetch_sub", "atomic_fetch_sub_explicit", 1, 1, ATOMIC_RETURNS_VALUE },
+    { "fetch_and", "atomic_fetch_and_explicit", 1, 1, ATOMIC_RETURNS_VALUE },
+    { "fetch_or", "atomic_fetch_or_explicit", 1, 1, ATOMIC_RETURNS_VALUE },
+    { "fetch_xor", "atomic_fetch_xor_explicit", 1, 1, ATOMIC_RETURNS_VALUE },
+    { NULL, NULL, 0, 0, ATOMIC_RETURNS_UNIT }
+};
+
+// 'atomic::<operation> a ...' operates on the 'atomic[T]' at address 'a',
+// with the memory orders given last
+static IrValue lower_atomic_operation(
+    Lowerer* l, const AtomicOperation* op, Node* called, size_t argc,
+    Node* argv, bool used
+) {
+    if(argc != 1 + op->valuec + op->orderc) {
+        panic("Invalid argument count!");
+    }
+    IrValue* values = (IrValue*) arena_alloc(l->arena, sizeof(IrValue) * argc);
+    values[0] = lower_value(l, argv, NULL);
+    Node* pointer = values[0].data_type;
+    if(pointer->type != POINTER_TYPE_NODE
+        || !ir_type_is_atomic(pointer->value.pointer_type.to)) {
+        panic("Atomic operations need the address of an atomic value!");
+    }
+    Node* value_type = pointer->value.pointer_type.to->value.namespace_access
+        .template_argv;
+    for(size_t vi = 1; vi <= op->valuec; vi += 1) {
+        // the expected value of a compare-exchange is passed by address
+        bool is_expected = op->returns == ATOMIC_RETURNS_BOOL && vi == 1;
+        values[vi] = lower_value(
+            l, argv + vi,
+            is_expected? pointer_type(l, value_type) : value_type
+        );
+    }
+    for(size_t oi = 1 + op->valuec; oi < argc; oi += 1) {
+        values[oi] = lower_value(l, argv + oi, NULL);
+    }
+    Node* return_type;
+    switch(op->returns) {
+        case ATOMIC_RETURNS_VALUE: return_type = value_type; break;
+        case ATOMIC_RETURNS_BOOL: return_type = core_type(l, "bool"); break;
+        case ATOMIC_RETURNS_UNIT: return_type = core_type(l, "unit"); break;
+    }
+    return emit_builtin(
+        l, called, op->builtin, IR_IMPURE, argc, values, return_type, used
+    );
+}
+
+static IrValue binary_value(
+    Lowerer* l, NodeType op, IrValue a, IrValue b, Node* type
+) {
+    size_t dest = add_temporary(l, type);
+    emit(l, (IrInstruction) {
+        .type = IR_BINARY,
+        .has_dest = true,
+        .dest = dest,
+        .value = { .binary = { .op = op, .a = a, .b = b } }
+    });
+    return local_value(l, dest);
+}
+
+static void store_place(Lowerer* l, IrPlace place, IrValue value) {
+    emit(l, (IrInstruction) {
+        .type = IR_STORE,
+        .has_dest = false,
+        .value = { .store = { .to = place, .value = value } }
+    });
+}
+
+// the place of the column of the struct-of-arrays at 'soa' that holds the
+// record member 'argi'
+static IrPlace soa_column(
+    Lowerer* l, IrPlace soa, Node* record, size_t argi
+) {
+    project_member(l, &soa, record->value.record.argnamev[argi]);
+    return soa;
+}
+
+static IrPlace slice_element(Lowerer* l, IrPlace slice, IrValue index) {
+    project(l, &slice, (IrProjection) {
+        .type = IR_PROJECTION_SLICE_INDEX,
+        .index = index
+    });
+    slice.data_type = slice.data_type->value.slice_type.of;
+    return slice;
+}
+
+// 'soa::push (&s) r' adds the row 'r' to the struct-of-arrays at '&s',
+// growing the columns to twice the rows whenever the row count reaches
+// a power of two (and trapping if there is no memory left)
+static void lower_soa_push(
+    Lowerer* l, Node* called, IrPlace soa, Node* record, IrValue length,
+    IrValue row
+) {
+    Node* usize = core_type(l, "usize");
+    size_t row_local = materialize(l, row);
+    IrValue below = binary_value(
+        l, SUBTRACTION_NODE, length, size_value(l, 1), usize
+    );
+    IrValue common = binary_value(
+        l, BITWISE_AND_NODE, length, below, usize
+    );
+    IrValue grows = binary_value(
+        l, EQUALS_NODE, common, size_value(l, 0), core_type(l, "bool")
+    );
+    size_t grow = ir_add_block(l->f);
+    size_t append = ir_add_block(l->f);
+    terminate(l, l->current, branch_to(grows, grow, append));
+    l->current = grow;
+    IrValue doubled = binary_value(
+        l, MULTIPLICATION_NODE, length, size_value(l, 2), usize
+    );
+    IrValue capacity = binary_value(
+        l, ADDITION_NODE, doubled, size_value(l, 1), usize
+    );
+    size_t argc = record->value.record.argc;
+    for(size_t argi = 0; argi < argc; argi += 1) {
+        IrPlace data = soa_column(l, soa, record, argi);
+        project_member(l, &data, string_wrap_nt("data"));
+        IrValue* args = (IrValue*) arena_alloc(l->arena, sizeof(IrValue) * 2);
+        args[0] = load_place(l, data);
+        args[1] = binary_value(
+            l, MULTIPLICATION_NODE, capacity,
+            (IrValue) {
+                .type = IR_VALUE_SIZE_OF,
+                .data_type = usize,
+                .value = { .size_of = record->value.record.argtypev + argi }
+            },
+            usize
+        );
+        IrValue grown_data = emit_builtin(
+            l, called, "__builtin_realloc", IR_IMPURE, 2, args,
+            data.data_type, true
+        );
+        IrValue null = (IrValue) {
+            .type = IR_VALUE_INTEGER,
+            .data_type = data.data_type,
+            .value = { .literal = string_wrap_nt("0") }
+        };
+        IrValue failed = binary_value(
+            l, EQUALS_NODE, grown_data, null, core_type(l, "bool")
+        );
+        size_t fail = ir_add_block(l->f);
+        terminate(l, fail, (IrTerminator) { .type = IR_TRAP });
+        size_t next = ir_add_block(l->f);
+        terminate(l, l->current, branch_to(failed, fail, next));
+        l->current = next;
+        store_place(l, data, grown_data);
+    }
+    terminate(l, l->current, jump_to(append));
+    l->current = append;
+    IrValue grown = binary_value(
+        l, ADDITION_NODE, length, size_value(l, 1), usize
+    );
+    for(size_t argi = 0; argi < argc; argi += 1) {
+        IrPlace column = soa_column(l, soa, record, argi);
+        IrPlace member = local_place(l, row_local);
+        project_member(l, &member, record->value.record.argnamev[argi]);
+        store_place(
+            l, slice_element(l, column, length), load_place(l, member)
+        );
+        project_member(l, &column, string_wrap_nt("length"));
+        store_place(l, column, grown);
+    }
+}
+
+// 'soa::len s', 'soa::get s i' and 'soa::set s i r' access the rows of
+// the struct-of-arrays 's', 'soa::push (&s) r' adds a row and
+// 'soa::free (&s)' releases the columns and leaves 's' empty
+static IrValue lower_soa_operation(
+    Lowerer* l, Node* called, size_t argc, Node* argv, bool used
+) {
+    bool by_address = is_builtin(called, "soa", "push")
+        || is_builtin(called, "soa", "free");
+    size_t expected_argc = is_builtin(called, "soa", "set")? 3
+        : is_builtin(called, "soa", "get")
+            || is_builtin(called, "soa", "push")? 2 : 1;
+    if(argc != expected_argc) { panic("Invalid argument count!"); }
+    IrValue operand = lower_value(l, argv, NULL);
+    Node* type = operand.data_type;
+    if(by_address && type->type == POINTER_TYPE_NODE) {
+        type = type->value.pointer_type.to;
+    } else if(by_address) {
+        panic("Operation needs the address of a struct-of-arrays!");
+    }
+    if(!ir_type_is_soa(type)) { panic("Operand is not a struct-of-arrays!"); }
+    Node* row_type = type->value.namespace_access.template_argv;
+    Node* record = symbol_variant(l, row_type, NULL);
+    if(record == NULL || record->type != RECORD_NODE
+        || record->value.record.argc == 0) {
+        panic("Struct-of-arrays need a record with members!");
+    }
+    IrPlace soa = by_address? (IrPlace) {
+        .type = IR_PLACE_DEREF,
+        .data_type = type,
+        .base = { .pointer = operand },
+        .projectionc = 0,
+        .projectionv = NULL
+    } : local_place(l, materialize(l, operand));
+    // all columns have as many elements as there are rows
+    IrValue length = element_count(l, soa_column(l, soa, record, 0));
+    size_t recordc = record->value.record.argc;
+    Node* unit = core_type(l, "unit");
+    if(is_builtin(called, "soa", "len")) { return length; }
+    if(is_builtin(called, "soa", "push")) {
+        IrValue row = lower_value(l, argv + 1, row_type);
+        lower_soa_push(l, called, soa, record, length, row);
+        return (IrValue) { .type = IR_VALUE_NONE, .data_type = unit };
+    }
+    if(is_builtin(called, "soa", "free")) {
+        for(size_t argi = 0; argi < recordc; argi += 1) {
+            IrPlace data = soa_column(l, soa, record, argi);
+            project_member(l, &data, string_wrap_nt("data"));
+            IrValue* pointer = (IrValue*) arena_alloc(
+                l->arena, sizeof(IrValue)
+            );
+            *pointer = load_place(l, data);
+            emit_builtin(
+                l, called, "__builtin_free", IR_IMPURE, 1, pointer, unit,
+                false
+            );
+        }
+        size_t empty = add_temporary(l, type);
+        emit(l, (IrInstruction) {
+            .type = IR_ARRAY,
+            .has_dest = true,
+            .dest = empty,
+            .value = { .array = { .type = type, .valuec = 0 } }
+        });
+        store_place(l, soa, local_value(l, empty));
+        return (IrValue) { .type = IR_VALUE_NONE, .data_type = unit };
+    }
+    IrValue index = lower_value(l, argv + 1, core_type(l, "usize"));
+    if(l->checked) { check_bounds(l, index, length, false); }
+    if(is_builtin(called, "soa", "set")) {
+        IrValue row = lower_value(l, argv + 2, row_type);
+        size_t row_local = materialize(l, row);
+        for(size_t argi = 0; argi < recordc; argi += 1) {
+            IrPlace member = local_place(l, row_local);
+            project_member(l, &member, record->value.record.argnamev[argi]);
+            IrPlace column = soa_column(l, soa, record, argi);
+            store_place(
+                l, slice_element(l, column, index), load_place(l, member)
+            );
+        }
+        return (IrValue) { .type = IR_VALUE_NONE, .data_type = unit };
+    }
+    // the row of a discarded 'soa::get' is not read
+    if(!used) { return (IrValue) { .type = IR_VALUE_NONE, .data_type = unit }; }
+    IrValue* values = (IrValue*) arena_alloc(
+        l->arena, sizeof(IrValue) * recordc
+    );
+    for(size_t argi = 0; argi < recordc; argi += 1) {
+        IrPlace column = soa_column(l, soa, record, argi);
+        values[argi] = load_place(l, slice_element(l, column, index));
+    }
+    size_t dest = add_temporary(l, row_type);
+    emit(l, (IrInstruction) {
+        .type = IR_RECORD,
+        .has_dest = true,
+        .dest = dest,
+        .value = { .record = {
+            .type = row_type,
+            .argc = recordc,
+            .argnamev = record->value.record.argnamev,
+            .argv = values
+        } }
+    });
+    return local_value(l, dest);
+}
+
+// the width of an integer type in bits
+static size_t integer_width(Node* type) {
+    String name = type->value.namespace_access.path.elements[0];
+    if(string_eq(name, string_wrap_nt("usize"))
+        || string_eq(name, string_wrap_nt("ssize"))) {
+        return sizeof(size_t) * 8;
+    }
+    STRING_AS_NT(string_slice(name, 1, name.length), digits);
+    return strtoull(digits, NULL, 10);
+}
+
+static IrValue lower_bit_intrinsic(
+    Lowerer* l, Node* called, const char* name, size_t argc, Node* argv,
+    bool used
+) {
+    if(argc != 1) { panic("Invalid argument count!"); }
+    IrValue* x = (IrValue*) arena_alloc(l->arena, sizeof(IrValue));
+    *x = lower_value(l, argv, NULL);
+    if(!ir_type_is_integer(x->data_type)) {
+        panic("Bit intrinsics need an integer!");
+    }
+    size_t width = integer_width(x->data_type);
+    bool is_swap = strcmp(name, "bswap") == 0;
+    if(is_swap && width == 8) {
+        panic("Bytes can not be swapped in a u8 or s8!");
+    }
+    // narrower types would count the bits of their promotion to 'int'
+    if(!is_swap && width < 32) {
+        panic("Bit intrinsics need 32 or 64 bit integers!");
+    }
+    // like '__builtin_bswap16' or '__builtin_popcountll'
+    const char* format = is_swap? "__builtin_%s%zu" : "__builtin_%s%s";
+    const char* suffix = width == 64? "ll" : "";
+    size_t length = is_swap? snprintf(NULL, 0, format, name, width)
+        : snprintf(NULL, 0, format, name, suffix);
+    char* builtin = (char*) arena_alloc(l->arena, length + 1);
+    if(is_swap) { sprintf(builtin, format, name, width); }
+    else { sprintf(builtin, format, name, suffix); }
+    return emit_builtin(
+        l, called, builtin, IR_CONST, 1, x,
+        is_swap? x->data_type : core_type(l, "u32"), used
+    );
+}
+
+// 'intrinsics::<name> ...' maps directly to the GCC / Clang builtins
+static IrValue lower_intrinsic(
+    Lowerer* l, Node* called, size_t argc, Node* argv, bool used
+) {
+    Node* unit = core_type(l, "unit");
+    IrValue* values = (IrValue*) arena_alloc(
+        l->arena, sizeof(IrValue) * (argc + 1)
+    );
+    const char* bit_intrinsics[] = {
+        "popcount", "ctz", "clz", "bswap", NULL
+    };
+    for(size_t ii = 0; bit_intrinsics[ii] != NULL; ii += 1) {
+        if(!is_builtin(called, "intrinsics", bit_intrinsics[ii])) { continue; }
+        return lower_bit_intrinsic(
+            l, called, bit_intrinsics[ii], argc, argv, used
+        );
+    }
+    bool is_likely = is_builtin(called, "intrinsics", "likely");
+    if(is_likely || is_builtin(called, "intrinsics", "unlikely")) {
+        if(argc != 1) { panic("Invalid argument count!"); }
+        values[0] = lower_value(l, argv, core_type(l, "bool"));
+        values[1] = (IrValue) {
+            .type = IR_VALUE_INTEGER,
+            .data_type = core_type(l, "s64"),
+            .value = { .literal = string_wrap_nt(is_likely? "1" : "0") }
+        };
+        return emit_builtin(
+            l, called, "__builtin_expect", IR_CONST, 2, values,
+            core_type(l, "bool"), used
+        );
+    }
+    if(is_builtin(called, "intrinsics", "prefetch")) {
+        // 'prefetch p' or 'prefetch p rw locality' with literals for whether
+        // the memory will be written (0 or 1) and how long to keep it (0 - 3)
+        if(argc != 1 && argc != 3) { panic("Invalid argument count!"); }
+        values[0] = lower_value(l, argv, NULL);
+        if(values[0].data_type->type != POINTER_TYPE_NODE) {
+            panic("Only addresses can be prefetched!");
+        }
+        for(size_t argi = 1; argi < argc; argi += 1) {
+            if(argv[argi].type != INTEGER_LITERAL_NODE
+                || integer_literal_value(argv + argi) > (argi == 1? 1 : 3)) {
+                panic("Invalid prefetch hint!");
+            }
+            values[argi] = lower_value(l, argv + argi, core_type(l, "s32"));
+        }
+        return emit_builtin(
+            l, called, "__builtin_prefetch", IR_IMPURE, argc, values, unit,
+            used
+        );
+    }
+    bool is_copy = is_builtin(called, "intrinsics", "copy");
+    if(is_copy || is_builtin(called, "intrinsics", "fill")) {
+        // 'copy to from n' and 'fill to byte n' work on 'n' bytes
+        if(argc != 3) { panic("Invalid argument count!"); }
+        values[0] = lower_value(l, argv, NULL);
+        values[1] = lower_value(
+            l, argv + 1, is_copy? NULL : core_type(l, "u8")
+        );
+        values[2] = lower_value(l, argv + 2, core_type(l, "usize"));
+        if(values[0].data_type->type != POINTER_TYPE_NODE
+            || (is_copy && values[1].data_type->type != POINTER_TYPE_NODE)) {
+            panic("Memory intrinsics need addresses!");
+        }
+        return emit_builtin(
+            l, called, is_copy? "__builtin_memcpy" : "__builtin_memset",
+            IR_IMPURE, 3, values, unit, used
+        );
+    }
+    if(is_builtin(called, "intrinsics", "unreachable")) {
+        if(argc != 0) { panic("Invalid argument count!"); }
+        return emit_builtin(
+            l, called, "__builtin_unreachable", IR_IMPURE, 0, NULL, unit, used
+        );
+    }
+    panic("UNHANDLED INTRINSIC!");
+}
+
+// functions provided by the compiler instead of a declaration
+static IrValue lower_builtin_call(
+    Lowerer* l, Node* called, size_t argc, Node* argv, bool used
+) {
+    if(is_builtin(called, "simd", "shuffle")) {
+        return lower_shuffle(l, called, argc, argv, used);
+    }
+    for(size_t oi = 0; memory_orders[oi][0] != NULL; oi += 1) {
+        if(!is_builtin(called, "atomic", memory_orders[oi][0])) { continue; }
+        if(argc != 0) { panic("Invalid argument count!"); }
+        // the C enumeration constant
+        return (IrValue) {
+            .type = IR_VALUE_INTEGER,
+            .data_type = core_type(l, "s32"),
+            .value = { .literal = string_wrap_nt(memory_orders[oi][1]) }
+        };
+    }
+    for(size_t oi = 0; atomic_operations[oi].name != NULL; oi += 1) {
+        const AtomicOperation* op = atomic_operations + oi;
+        if(!is_builtin(called, "atomic", op->name)) { continue; }
+        return lower_atomic_operation(l, op, called, argc, argv, used);
+    }
+    const char* soa_operations[] = {
+        "len", "get", "set", "push", "free", NULL
+    };
+    for(size_t oi = 0; soa_operations[oi] != NULL; oi += 1) {
+        if(!is_builtin(called, "soa", soa_operations[oi])) { continue; }
+        return lower_soa_operation(l, called, argc, argv, used);
+    }
+    const char* intrinsics[] = {
+        "likely", "unlikely", "prefetch", "popcount", "ctz", "clz", "bswap",
+        "copy", "fill", "unreachable", NULL
+    };
+    for(size_t ii = 0; intrinsics[ii] != NULL; ii += 1) {
+        if(!is_builtin(called, "intrinsics", intrinsics[ii])) { continue; }
+        return lower_intrinsic(l, called, argc, argv, used);
+    }
+    // 'task::resume t' runs the task until it suspends and returns whether
+    // it has finished, 'task::free t' frees its frame
+    bool resumes = is_builtin(called, "task", "resume");
+    if(resumes || is_builtin(called, "task", "free")) {
+        if(argc != 1) { panic("Invalid argument count!"); }
+        IrValue* task = (IrValue*) arena_alloc(l->arena, sizeof(IrValue));
+        *task = lower_value(l, argv, core_type(l, "task"));
+        return emit_builtin(
+            l, called, resumes? "nino_task_resume" : "nino_task_free",
+            IR_IMPURE, 1, task, core_type(l, resumes? "bool" : "unit"), used
+        );
+    }
+    if(is_builtin(called, "atomic", "fence")) {
+        if(argc != 1) { panic("Invalid argument count!"); }
+        IrValue* order = (IrValue*) arena_alloc(l->arena, sizeof(IrValue));
+        *order = lower_value(l, argv, NULL);
+        return emit_builtin(
+            l, called, "atomic_thread_fence", IR_IMPURE, 1, order,
+            core_type(l, "unit"), used
+        );
+    }
+    panic("Called value is not a known function or record!");
+}
+
+// starts a frame of the async function 'called' with the arguments,
+// returning the function
+static Node* lower_coroutine(
+    Lowerer* l, Node* called, size_t argc, Node* argv, IrInstruction* i
+) {
+    Symbol* s;
+    Node* variant = symbol_variant(l, called, &s);
+    if(variant == NULL || variant->type != FUNCTION_NODE
+        || !variant->value.function.is_async) {
+        panic("Only calls of async functions can be awaited!");
+    }
+    i->value.coroutine.path = s->path;
+    i->value.coroutine.variant = called->value.namespace_access.variant;
+    i->value.coroutine.argc = argc;
+    i->value.coroutine.argv = lower_arguments(
+        l, argc, argv,
+        variant->value.function.argc, variant->value.function.argtypev
+    );
+    return variant;
+}
+
+// 'await f a b' runs the async function as a part of the caller
+static IrValue lower_await(Lowerer* l, Node* n, bool used) {
+    if(!l->f->is_async) { panic("Only async functions can await!"); }
+    Node* awaited = n->value.await.call;
+    IrInstruction await = (IrInstruction) {
+        .type = IR_AWAIT,
+        .has_dest = false
+    };
+    Node* function = awaited->type == CALL_NODE
+        ? lower_coroutine(
+            l, awaited->value.call.called, awaited->value.call.argc,
+            awaited->value.call.argv, &await
+        )
+        : lower_coroutine(l, awaited, 0, NULL, &await);
+    Node* return_type = function->value.function.return_type;
+    if(used && !ir_type_is_unit(return_type)) {
+        await.has_dest = true;
+        await.dest = add_temporary(l, return_type);
+    }
+    emit(l, await);
+    if(!await.has_dest) {
+        return (IrValue) { .type = IR_VALUE_NONE, .data_type = return_type };
+    }
+    return local_value(l, await.dest);
+}
+
+// an async function that is called without being awaited gives a task
+static IrValue lower_task(
+    Lowerer* l, Node* called, size_t argc, Node* argv
+) {
+    IrInstruction task = (IrInstruction) {
+        .type = IR_TASK,
+        .has_dest = true
+    };
+    lower_coroutine(l, called, argc, argv, &task);
+    task.dest = add_temporary(l, core_type(l, "task"));
+    emit(l, task);
+    return local_value(l, task.dest);
+}
+
+static IrValue lower_call(
+    Lowerer* l, Node* called, size_t argc, Node* argv, bool used
+) {
+    Symbol* s;
+    Node* variant = symbol_variant(l, called, &s);
+    if(variant == NULL) {
+        return lower_builtin_call(l, called, argc, argv, used);
+    }
+    IrInstruction call = (IrInstruction) {
+        .type = IR_CALL,
+        .has_dest = false
+    };
+    Node* return_type;
+    switch(variant->type) {
+        case FUNCTION_NODE:
+            if(variant->value.function.is_async) {
+                return lower_task(l, called, argc, argv);
+            }
+            call.value.call.is_external = false;
+            call.value.call.path = s->path;
+            call.value.call.variant = called->value.namespace_access.variant;
+            call.value.call.purity = IR_IMPURE;
+            call.value.call.argc = argc;
+            call.value.call.argv = lower_arguments(
+                l, argc, argv,
+                variant->value.function.argc, variant->value.function.argtypev
+            );
+            return_type = variant->value.function.return_type;
+            break;
+        case EXTERNAL_FUNCTION_NODE:
+            call.value.call.is_external = true;
+            call.value.call.path = s->path;
+            call.value.call.variant = called->value.namespace_access.variant;
+            call.value.call.purity = ir_external_purity(variant);
+            call.value.call.external_name
+                = variant->value.external_function.external_name;
+            call.value.call.argc = argc;
+            call.value.call.argv = lower_arguments(
+                l, argc, argv,
+                variant->value.external_function.argc,
+                variant->value.external_function.argtypev
+            );
+            return_type = variant->value.external_function.return_type;
+            break;
+        case RECORD_NODE: {
+            IrValue* values = lower_arguments(
+                l, argc, argv,
+                variant->value.record.argc, variant->value.record.argtypev
+            );
+            size_t dest = add_temporary(l, called);
+            emit(l, (IrInstruction) {
+                .type = IR_RECORD,
+                .has_dest = true,
+                .dest = dest,
+                .value = { .record = {
+                    .type = called,
+                    .argc = argc,
+                    .argnamev = variant->value.record.argnamev,
+                    .argv = values
+                } }
+            });
+            return local_value(l, dest);
+        }
+        case UNION_NODE:
+            return lower_union_construction(l, called, variant, argc, argv);
+        default:
+            panic("Called value is not a known function or record!");
+    }
+    if(used && !ir_type_is_unit(return_type)) {
+        call.has_dest = true;
+        call.dest = add_temporary(l, return_type);
+    }
+    emit(l, call);
+    if(!call.has_dest) {
+        return (IrValue) { .type = IR_VALUE_NONE, .data_type = return_type };
+    }
+    return local_value(l, call.dest);
+}
+
+// the value of a 'match' pattern as a case of a switch on 'type'
+static uint64_t pattern_value(Node* pattern, Node* type) {
+    if(ir_type_is_core(type, "bool")) {
+        if(pattern->type != BOOLEAN_LITERAL_NODE) {
+            panic("Pattern does not match the type of the value!");
+        }
+        return string_eq(
+            pattern->value.boolean_literal.value, string_wrap_nt("true")
+        );
+    }
+    if(pattern->type != INTEGER_LITERAL_NODE) {
+        panic("Pattern does not match the type of the value!");
+    }
+    STRING_AS_NT(pattern->value.integer_literal.value, digits);
+    bool is_negative = digits[0] == '-';
+    uint64_t value = is_negative
+        ? (uint64_t) strtoll(digits, NULL, 10) : strtoull(digits, NULL, 10);
+    size_t width = integer_width(type);
+    bool is_signed = string_char_at(
+        type->value.namespace_access.path.elements[0], 0
+    ) == 's';
+    bool fits;
+    if(is_signed) {
+        int64_t limit = width >= 64? INT64_MAX
+            : ((int64_t) 1 << (width - 1)) - 1;
+        fits = is_negative? (int64_t) value >= -limit - 1
+            : value <= (uint64_t) limit;
+    } else {
+        fits = !is_negative && (width >= 64 || value < (uint64_t) 1 << width);
+    }
+    if(!fits) { panic("Pattern does not fit the type of the value!"); }
+    return value;
+}
+
+// whether 'a' is less than 'b' as values of 'type'
+static bool case_less(uint64_t a, uint64_t b, Node* type) {
+    bool is_signed = ir_type_is_integer(type) && string_char_at(
+        type->value.namespace_access.path.elements[0], 0
+    ) == 's';
+    return is_signed? (int64_t) a < (int64_t) b : a < b;
+}
+
+// the value of the tag of a matched union case
+static uint64_t union_pattern_value(Node* tagged_union, MatchPattern* pattern) {
+    if(pattern->low->type != VARIABLE_NODE) {
+        panic("Pattern does not match the type of the value!");
+    }
+    if(pattern->high != NULL) { panic("Union cases can not form a range!"); }
+    size_t casei = union_case(tagged_union, pattern->low->value.variable.name);
+    size_t niche = ir_union_niche(tagged_union);
+    if(niche < tagged_union->value.tagged_union.casec) {
+        return casei == niche;
+    }
+    return casei;
+}
+
+// 'tagged_union' is NULL unless the tag of a union is matched
+static IrTerminator lower_match_cases(
+    Lowerer* l, Node* match, IrValue value, Node* tagged_union,
+    size_t* bodies, size_t otherwise
+) {
+    Node* type = value.data_type;
+    size_t casec = 0;
+    for(size_t armi = 0; armi < match->value.match.armc; armi += 1) {
+        casec += match->value.match.armv[armi].patternc;
+    }
+    IrSwitchCase* casev = (IrSwitchCase*) arena_alloc(
+        l->arena, sizeof(IrSwitchCase) * casec
+    );
+    size_t casei = 0;
+    for(size_t armi = 0; armi < match->value.match.armc; armi += 1) {
+        MatchArm* arm = match->value.match.armv + armi;
+        for(size_t pi = 0; pi < arm->patternc; pi += 1) {
+            MatchPattern* pattern = arm->patternv + pi;
+            IrSwitchCase c;
+            c.low = tagged_union != NULL
+                ? union_pattern_value(tagged_union, pattern)
+                : pattern_value(pattern->low, type);
+            c.high = c.low;
+            if(pattern->high != NULL) {
+                // ranges exclude their end, like slices
+                uint64_t end = pattern_value(pattern->high, type);
+                if(!case_less(c.low, end, type)) {
+                    panic("Match range is empty!");
+                }
+                c.high = end - 1;
+            }
+            c.to = bodies[armi];
+            for(size_t ci = 0; ci < casei; ci += 1) {
+                bool overlaps = !case_less(casev[ci].high, c.low, type)
+                    && !case_less(c.high, casev[ci].low, type);
+                if(overlaps) { panic("Match arms overlap!"); }
+            }
+            casev[casei] = c;
+            casei += 1;
+        }
+    }
+    return (IrTerminator) {
+        .type = IR_SWITCH,
+        .value = { .switch_on = {
+            .value = value, .casec = casec, .casev = casev,
+            .otherwise = otherwise
+        } }
+    };
+}
+
+static IrFunction function_new(
+    Namespace path, size_t variant, Node* return_type, size_t argc
+) {
+    IrFunction f;
+    f.path = path;
+    f.variant = variant;
+    f.return_type = return_type;
+    f.purity = IR_IMPURE;
+    f.returns_by_pointer = false;
+    f.returns_opaque_pointer = false;
+    f.is_parallel_body = false;
+    f.is_async = false;
+    f.argc = argc;
+    f.local_count = 0;
+    f.locals_bsize = 8;
+    f.locals = (IrLocal*) malloc(sizeof(IrLocal) * f.locals_bsize);
+    f.block_count = 0;
+    f.blocks_bsize = 4;
+    f.blocks = (IrBlock*) malloc(sizeof(IrBlock) * f.blocks_bsize);
+    f.loop_count = 0;
+    f.loops_bsize = 2;
+    f.loops = (IrLoop*) malloc(sizeof(IrLoop) * f.loops_bsize);
+    return f;
+}
+
+static void program_add_function(IrProgram* p, IrFunction f) {
+    if(p->function_count + 1 > p->functions_bsize) {
+        p->functions_bsize *= 2;
+        p->functions = (IrFunction*) realloc(
+            p->functions, sizeof(IrFunction) * p->functions_bsize
+        );
+    }
+    p->functions[p->function_count] = f;
+    p->function_count += 1;
+}
+
+// lowers the body of a 'par' loop into a function of the visible locals
+// that are 'captured', the index and the end of the indices
+static IrFunction lower_parallel_body(
+    Lowerer* outer, Node* n, Namespace path, bool* captured
+) {
+    IrFunction f = function_new(
+        path, outer->f->variant, core_type(outer, "unit"), 0
+    );
+    f.is_parallel_body = true;
+    Lowerer lowerer = (Lowerer) {
+        .f = &f,
+        .symbols = outer->symbols,
+        .arena = outer->arena,
+        .checked = outer->checked,
+        .current = ir_add_block(&f),
+        .scope = arraybuilder_new(ScopeEntry)(),
+        .program = outer->program,
+        .parallel_count = 0
+    };
+    Lowerer* l = &lowerer;
+    ScopeEntry* visible = (ScopeEntry*) outer->scope.buffer;
+    for(size_t vi = 0; vi < outer->scope.length; vi += 1) {
+        if(!captured[vi]) { continue; }
+        size_t local = ir_add_local(&f, (IrLocal) {
+            .name = visible[vi].name,
+            .is_temporary = false,
+            .is_argument = true,
+            .is_address_taken = false,
+            .type = outer->f->locals[visible[vi].local].type
+        });
+        arraybuilder_push(ScopeEntry)(&l->scope, (ScopeEntry) {
+            .name = visible[vi].name, .local = local
+        });
+    }
+    Node* index_type = core_type(l, "usize");
+    size_t index = ir_add_local(&f, (IrLocal) {
+        .name = n->value.par.index,
+        .is_temporary = false,
+        .is_argument = true,
+        .is_address_taken = false,
+        .type = index_type
+    });
+    arraybuilder_push(ScopeEntry)(&l->scope, (ScopeEntry) {
+        .name = n->value.par.index, .local = index
+    });
+    size_t end = ir_add_local(&f, (IrLocal) {
+        .name = string_wrap_nt("end"),
+        .is_temporary = false,
+        .is_argument = true,
+        .is_address_taken = false,
+        .type = index_type
+    });
+    f.argc = f.local_count;
+    size_t header = ir_add_block(&f);
+    terminate(l, l->current, jump_to(header));
+    l->current = header;
+    size_t in_range = add_temporary(l, core_type(l, "bool"));
+    emit(l, (IrInstruction) {
+        .type = IR_BINARY,
+        .has_dest = true,
+        .dest = in_range,
+        .value = { .binary = {
+            .op = LESS_THAN_NODE,
+            .a = local_value(l, index),
+            .b = local_value(l, end)
+        } }
+    });
+    size_t body = ir_add_block(&f);
+    l->current = body;
+    lower_block(l, n->value.par.body);
+    size_t next = add_temporary(l, index_type);
+    emit(l, (IrInstruction) {
+        .type = IR_BINARY,
+        .has_dest = true,
+        .dest = next,
+        .value = { .binary = {
+            .op = ADDITION_NODE,
+            .a = local_value(l, index),
+            .b = (IrValue) {
+                .type = IR_VALUE_INTEGER,
+                .data_type = index_type,
+                .value = { .literal = string_wrap_nt("1") }
+            }
+        } }
+    });
+    store_local(l, index, local_value(l, next));
+    terminate(l, l->current, jump_to(header));
+    size_t done = ir_add_block(&f);
+    terminate(l, header, branch_to(local_value(l, in_range), body, done));
+    ir_add_loop(&f, (IrLoop) {
+        .header = header, .end = done,
+        .attributes = (Attributes) { .length = 0 }
+    });
+    terminate(l, done, (IrTerminator) {
+        .type = IR_RETURN,
+        .value = { .return_value = { .has_value = false } }
+    });
+    arraybuilder_discard(ScopeEntry)(&l->scope);
+    return f;
+}
+
+static void mark_local_used(IrValue* v, void* data) {
+    bool* used = (bool*) data;
+    if(v->type == IR_VALUE_LOCAL) { used[v->value.local] = true; }
+}
+
+static void mark_place_local_used(IrPlace* p, void* data) {
+    bool* used = (bool*) data;
+    if(p->type == IR_PLACE_LOCAL) { used[p->base.local] = true; }
+}
+
+// the body becomes a function of the locals it reads, which is called for
+// parts of the indices on multiple threads
+static void lower_parallel(Lowerer* l, Node* n) {
+    if(l->program == NULL) {
+        panic("Parallel loops can not be used in constants!");
+    }
+    Node* index_type = core_type(l, "usize");
+    IrValue start = lower_value(l, n->value.par.start, index_type);
+    IrValue end = lower_value(l, n->value.par.end, index_type);
+    // the element starts with a digit, so it never names a declared symbol
+    size_t length = snprintf(NULL, 0, "%zupar", l->parallel_count);
+    char* name = (char*) arena_alloc(l->arena, length + 1);
+    sprintf(name, "%zupar", l->parallel_count);
+    l->parallel_count += 1;
+    String* elements = (String*) arena_alloc(
+        l->arena, sizeof(String) * (l->f->path.length + 1)
+    );
+    memcpy(elements, l->f->path.elements, sizeof(String) * l->f->path.length);
+    elements[l->f->path.length] = string_wrap_nt_slice(name, length);
+    Namespace path = (Namespace) {
+        .elements = elements, .length = l->f->path.length + 1
+    };
+    // the body is lowered capturing every visible local to find the ones
+    // it uses, then again only capturing those
+    size_t visiblec = l->scope.length;
+    bool captured[visiblec + 1];
+    for(size_t vi = 0; vi < visiblec; vi += 1) { captured[vi] = true; }
+    size_t function_count = l->program->function_count;
+    IrFunction probe = lower_parallel_body(l, n, path, captured);
+    bool used[probe.local_count + 1];
+    for(size_t locali = 0; locali < probe.local_count; locali += 1) {
+        used[locali] = false;
+    }
+    IrVisitor mark_used = (IrVisitor) {
+        .visit_value = &mark_local_used,
+        .visit_place = &mark_place_local_used,
+        .data = used
+    };
+    for(size_t blocki = 0; blocki < probe.block_count; blocki += 1) {
+        IrBlock* block = probe.blocks + blocki;
+        for(size_t ii = 0; ii < block->instruction_count; ii += 1) {
+            ir_visit_instruction(block->instructions + ii, &mark_used);
+        }
+        ir_visit_terminator(&block->terminator, &mark_used);
+    }
+    for(size_t vi = 0; vi < visiblec; vi += 1) { captured[vi] = used[vi]; }
+    ir_function_free(&probe);
+    // and the bodies of the loops nested in it
+    while(l->program->function_count > function_count) {
+        l->program->function_count -= 1;
+        ir_function_free(
+            l->program->functions + l->program->function_count
+        );
+    }
+    IrFunction body = lower_parallel_body(l, n, path, captured);
+    program_add_function(l->program, body);
+    IrValue* capturev = (IrValue*) arena_alloc(
+        l->arena, sizeof(IrValue) * (visiblec + 1)
+    );
+    size_t capturec = 0;
+    ScopeEntry* visible = (ScopeEntry*) l->scope.buffer;
+    for(size_t vi = 0; vi < visiblec; vi += 1) {
+        if(!captured[vi]) { continue; }
+        capturev[capturec] = local_value(l, visible[vi].local);
+        capturec += 1;
+    }
+    emit(l, (IrInstruction) {
+        .type = IR_PARALLEL,
+        .has_dest = false,
+        .value = { .parallel = {
+            .path = path, .variant = l->f->variant,
+            .start = start, .end = end,
+            .capturec = capturec, .capturev = capturev
+        } }
+    });
+}
+
+// makes the value of the case matched by the arm available under its name
+static void bind_union_case(
+    Lowerer* l, MatchArm* arm, IrPlace matched, Node* tagged_union
+) {
+    if(tagged_union == NULL) { panic("Only union cases can be named!"); }
+    if(arm->patternc != 1 || arm->patternv[0].low->type != VARIABLE_NODE) {
+        panic("Only arms matching one case can name its value!");
+    }
+    size_t casei = union_case(
+        tagged_union, arm->patternv[0].low->value.variable.name
+    );
+    Node* case_type = tagged_union->value.tagged_union.casetypev + casei;
+    if(ir_type_is_unit(case_type)) { panic("Union case has no value!"); }
+    project(l, &matched, (IrProjection) {
+        .type = IR_PROJECTION_MEMBER,
+        .member = union_case_member(l, tagged_union, casei)
+    });
+    matched.data_type = case_type;
+    IrValue value = load_place(l, matched);
+    IrLocal* local = l->f->locals + value.value.local;
+    local->name = arm->binding;
+    local->is_temporary = false;
+    arraybuilder_push(ScopeEntry)(&l->scope, (ScopeEntry) {
+        .name = arm->binding,
+        .local = value.value.local
+    });
+}
+
+static void lower_statement(Lowerer* l, Node* n) {
+    switch(n->type) {
+        case VARIABLE_DECLARATION_NODE: {
+            Node* type = n->value.variable_declaration.type;
+            IrValue value = lower_value(
+                l, n->value.variable_declaration.value, type
+            );
+            IrBlock* current = l->f->blocks + l->current;
+            IrInstruction* last = current->instruction_count == 0? NULL
+                : current->instructions + current->instruction_count - 1;
+            bool names_temporary = value.type == IR_VALUE_LOCAL
+                && l->f->locals[value.value.local].is_temporary
+                && last != NULL && last->has_dest
+                && last->dest == value.value.local
+                && template_arg_eq(value.data_type, type);
+            if(names_temporary) {
+                // the value has just been computed into a fresh temporary,
+                // which simply becomes the variable
+                IrLocal* local = l->f->locals + value.value.local;
+                local->name = n->value.variable_declaration.name;
+                local->is_temporary = false;
+                arraybuilder_push(ScopeEntry)(&l->scope, (ScopeEntry) {
+                    .name = n->value.variable_declaration.name,
+                    .local = value.value.local
+                });
+                return;
+            }
+            size_t local = ir_add_local(l->f, (IrLocal) {
+                .name = n->value.variable_declaration.name,
+                .is_temporary = false,
+                .is_argument = false,
+                .is_address_taken = false,
+                .type = type
+            });
+            if(value.type != IR_VALUE_NONE) { store_local(l, local, value); }
+            arraybuilder_push(ScopeEntry)(&l->scope, (ScopeEntry) {
+                .name = n->value.variable_declaration.name,
+                .local = local
+            });
+            return;
+        }
+        case ASSIGNMENT_NODE: {
+            IrPlace place = lower_place(l, n->value.assignment.to);
+            if(place.type == IR_PLACE_CONSTANT) {
+                panic("Constants can not be assigned!");
+            }
+            // each thread has its own copy of them
+            bool is_captured = l->f->is_parallel_body
+                && !ir_place_is_indirect(&place)
+                && place.base.local < l->f->argc;
+            if(is_captured) {
+                panic("Parallel loops can only assign their own variables!");
+            }
+            if(place_is_read_only(&place)) {
+                panic("Can not assign through a constant pointer!");
+            }
+            IrValue value = lower_value(
+                l, n->value.assignment.value, place.data_type
+            );
+            emit(l, (IrInstruction) {
+                .type = IR_STORE,
+                .has_dest = false,
+                .value = { .store = { .to = place, .value = value } }
+            });
+            return;
+        }
+        case RETURN_VALUE_NODE: {
+            if(l->f->is_parallel_body) {
+                panic("Can not return from a parallel loop!");
+            }
+            IrTerminator ret = (IrTerminator) {
+                .type = IR_RETURN,
+                .value = { .return_value = { .has_value = false } }
+            };
+            if(n->value.return_value.has_value) {
+                IrValue value = lower_value(
+                    l, n->value.return_value.value, l->f->return_type
+                );
+                if(value.type != IR_VALUE_NONE
+                    && !ir_type_is_unit(l->f->return_type)) {
+                    ret.value.return_value.has_value = true;
+                    ret.value.return_value.value = value;
+                }
+            }
+            terminate(l, l->current, ret);
+            l->current = ir_add_block(l->f);
+            return;
+        }
+        case IF_ELSE_NODE: {
+            IrValue condition = lower_value(
+                l, n->value.if_else.condition, core_type(l, "bool")
+            );
+            size_t from = l->current;
+            size_t if_body = ir_add_block(l->f);
+            l->current = if_body;
+            lower_block(l, n->value.if_else.if_body);
+            size_t if_end = l->current;
+            bool has_else = n->value.if_else.else_body.length > 0;
+            size_t else_body, else_end;
+            if(has_else) {
+                else_body = ir_add_block(l->f);
+                l->current = else_body;
+                lower_block(l, n->value.if_else.else_body);
+                else_end = l->current;
+            }
+            size_t end = ir_add_block(l->f);
+            terminate(l, if_end, jump_to(end));
+            if(has_else) { terminate(l, else_end, jump_to(end)); }
+            terminate(l, from, branch_to(
+                condition, if_body, has_else? else_body : end
+            ));
+            l->current = end;
+            return;
+        }
+        case MATCH_NODE: {
+            IrValue value = lower_value(l, n->value.match.value, NULL);
+            Node* tagged_union = symbol_variant(l, value.data_type, NULL);
+            if(tagged_union != NULL && tagged_union->type != UNION_NODE) {
+                tagged_union = NULL;
+            }
+            IrPlace matched;
+            if(tagged_union != NULL) {
+                matched = local_place(l, materialize(l, value));
+                value = union_tag(l, matched, tagged_union);
+            } else if(!ir_type_is_integer(value.data_type)
+                && !ir_type_is_core(value.data_type, "bool")) {
+                panic("Only integers, booleans and unions can be matched!");
+            }
+            size_t from = l->current;
+            size_t armc = n->value.match.armc;
+            size_t bodies[armc + 1];
+            size_t body_ends[armc + 1];
+            for(size_t armi = 0; armi < armc; armi += 1) {
+                MatchArm* arm = n->value.match.armv + armi;
+                bodies[armi] = ir_add_block(l->f);
+                l->current = bodies[armi];
+                size_t scope_length = l->scope.length;
+                if(arm->has_binding) {
+                    bind_union_case(l, arm, matched, tagged_union);
+                }
+                lower_block(l, arm->body);
+                l->scope.length = scope_length;
+                body_ends[armi] = l->current;
+            }
+            bool has_else = n->value.match.else_body.length > 0;
+            if(has_else) {
+                bodies[armc] = ir_add_block(l->f);
+                l->current = bodies[armc];
+                lower_block(l, n->value.match.else_body);
+                body_ends[armc] = l->current;
+            }
+            size_t end = ir_add_block(l->f);
+            for(size_t armi = 0; armi < armc + (has_else? 1 : 0); armi += 1) {
+                terminate(l, body_ends[armi], jump_to(end));
+            }
+            terminate(l, from, lower_match_cases(
+                l, n, value, tagged_union, bodies,
+                has_else? bodies[armc] : end
+            ));
+            l->current = end;
+            return;
+        }
+        case WHILE_DO_NODE: {
+            size_t header = ir_add_block(l->f);
+            terminate(l, l->current, jump_to(header));
+            l->current = header;
+            IrValue condition = lower_value(
+                l, n->value.while_do.condition, core_type(l, "bool")
+            );
+            size_t condition_end = l->current;
+            size_t body = ir_add_block(l->f);
+            l->current = body;
+            lower_block(l, n->value.while_do.body);
+            terminate(l, l->current, jump_to(header));
+            size_t end = ir_add_block(l->f);
+            terminate(l, condition_end, branch_to(condition, body, end));
+            ir_add_loop(l->f, (IrLoop) {
+                .header = header, .end = end,
+                .attributes = n->value.while_do.attributes
+            });
+            l->current = end;
+            return;
+        }
+        case PAR_NODE:
+            lower_parallel(l, n);
+            return;
+        case AWAIT_NODE:
+            lower_await(l, n, false);
+            return;
+        case YIELD_NODE:
+            if(!l->f->is_async) { panic("Only async functions can yield!"); }
+            emit(l, (IrInstruction) { .type = IR_YIELD, .has_dest = false });
+            return;
+        case CALL_NODE:
+            lower_call(
+                l, n->value.call.called, n->value.call.argc, n->value.call.argv,
+                false
+            );
+            return;
+        case NAMESPACE_ACCESS_NODE:
+            lower_call(l, n, 0, NULL, false);
+            return;
+        case GLOBAL_NODE:
+            panic("Globals must be declared outside of functions!");
+        default:
+            lower_value(l, n, NULL);
+            return;
+    }
+}
+
+static void lower_block(Lowerer* l, Block b) {
+    size_t scope_length = l->scope.length;
+    for(size_t si = 0; si < b.length; si += 1) {
+        lower_statement(l, b.statements + si);
+    }
+    l->scope.length = scope_length;
+}
+
+// whether the block only returns (possibly after jumping through empty
+// blocks), returning 'value' if 'has_value' is true
+static bool only_returns(
+    IrFunction* f, size_t block, bool has_value, size_t value
+) {
+    for(size_t steps = 0; steps < f->block_count; steps += 1) {
+        IrTerminator* t = &f->blocks[block].terminator;
+        if(t->type == IR_RETURN) {
+            if(t->value.return_value.has_value != has_value) { return false; }
+            return !has_value
+                || (t->value.return_value.value.type == IR_VALUE_LOCAL
+                    && t->value.return_value.value.value.local == value);
+        }
+        if(t->type != IR_JUMP) { return false; }
+        block = t->value.jump.to;
+        if(f->blocks[block].instruction_count > 0) { return false; }
+    }
+    return false;
+}
+
+// replaces calls of the function to itself that are directly returned
+// by assigning the arguments and jumping back to the start of the function
+static void lower_self_tail_calls(IrFunction* f) {
+    for(size_t locali = 0; locali < f->local_count; locali += 1) {
+        // the locals of the caller may still be referenced by the callee
+        if(f->locals[locali].is_address_taken) { return; }
+    }
+    for(size_t blocki = 0; blocki < f->block_count; blocki += 1) {
+        IrBlock* block = f->blocks + blocki;
+        if(block->instruction_count == 0) { continue; }
+        IrInstruction call = block->instructions[block->instruction_count - 1];
+        bool is_self_call = call.type == IR_CALL
+            && !call.value.call.is_external
+            && call.value.call.variant == f->variant
+            && namespace_eq(call.value.call.path, f->path);
+        if(!is_self_call) { continue; }
+        if(block->terminator.type != IR_RETURN
+            && block->terminator.type != IR_JUMP) { continue; }
+        if(!only_returns(f, blocki, call.has_dest, call.dest)) { continue; }
+        block->instruction_count -= 1;
+        IrValue* argv = call.value.call.argv;
+        // arguments that read an argument which is assigned earlier need
+        // to be copied first
+        for(size_t argi = 0; argi < f->argc; argi += 1) {
+            bool reads_assigned = argv[argi].type == IR_VALUE_LOCAL
+                && argv[argi].value.local < argi;
+            if(!reads_assigned) { continue; }
+            size_t copy = ir_add_local(f, (IrLocal) {
+                .name = string_wrap_nt(""),
+                .is_temporary = true,
+                .is_argument = false,
+                .is_address_taken = false,
+                .type = f->locals[argv[argi].value.local].type
+            });
+            ir_block_push(block, (IrInstruction) {
+                .type = IR_STORE,
+                .has_dest = false,
+                .value = { .store = {
+                    .to = (IrPlace) {
+                        .type = IR_PLACE_LOCAL,
+                        .data_type = f->locals[copy].type,
+                        .base = { .local = copy },
+                        .projectionc = 0,
+                        .projectionv = NULL
+                    },
+                    .value = argv[argi]
+                } }
+            });
+            argv[argi].value.local = copy;
+        }
+        for(size_t argi = 0; argi < f->argc; argi += 1) {
+            bool is_unchanged = argv[argi].type == IR_VALUE_LOCAL
+                && argv[argi].value.local == argi;
+            if(is_unchanged) { continue; }
+            ir_block_push(block, (IrInstruction) {
+                .type = IR_STORE,
+                .has_dest = false,
+                .value = { .store = {
+                    .to = (IrPlace) {
+                        .type = IR_PLACE_LOCAL,
+                        .data_type = f->locals[argi].type,
+                        .base = { .local = argi },
+                        .projectionc = 0,
+                        .projectionv = NULL
+                    },
+                    .value = argv[argi]
+                } }
+            });
+        }
+        block->terminator = (IrTerminator) {
+            .type = IR_JUMP,
+            .value = { .jump = { .to = 0 } }
+        };
+    }
+}
+
+IrFunction ir_lower_function(
+    Node* function, size_t variant, SymbolTable* symbols, bool checked,
+    IrProgram* program, Arena* arena
+) {
+    IrFunction f = function_new(
+        function->value.function.path, variant,
+        function->value.function.return_type, function->value.function.argc
+    );
+    f.is_async = function->value.function.is_async;
+    Lowerer lowerer = (Lowerer) {
+        .f = &f,
+        .symbols = symbols,
+        .arena = arena,
+        .checked = checked,
+        .current = ir_add_block(&f),
+        .scope = arraybuilder_new(ScopeEntry)(),
+        .program = program,
+        .parallel_count = 0
+    };
+    Lowerer* l = &lowerer;
+    for(size_t argi = 0; argi < f.argc; argi += 1) {
+        size_t local = ir_add_local(&f, (IrLocal) {
+            .name = function->value.function.argnamev[argi],
+            .is_temporary = false,
+            .is_argument = true,
+            .is_address_taken = false,
+            .type = function->value.function.argtypev + argi
+        });
+        arraybuilder_push(ScopeEntry)(&l->scope, (ScopeEntry) {
+            .name = function->value.function.argnamev[argi],
+            .local = local
+        });
+    }
+    lower_block(l, function->value.function.body);
+    if(ir_type_is_unit(f.return_type)) {
+        terminate(l, l->current, (IrTerminator) {
+            .type = IR_RETURN,
+            .value = { .return_value = { .has_value = false } }
+        });
+    }
+    arraybuilder_discard(ScopeEntry)(&l->scope);
+    lower_self_tail_calls(&f);
+    return f;
+}
+
+
+// the initializer of a constant is lowered like 'fun c -> T { return v; }'
+static IrConstant lower_constant(
+    Namespace path, Node* type, Node* value, SymbolTable* symbols,
+    bool checked, Arena* arena
+) {
+    Node* body = (Node*) arena_alloc(arena, sizeof(Node));
+    *body = (Node) {
+        .type = RETURN_VALUE_NODE,
+        .value = { .return_value = { .has_value = true, .value = value } }
+    };
+    Node function = (Node) {
+        .type = FUNCTION_NODE,
+        .value = { .function = {
+            .is_public = false,
+            .path = path,
+            .template_argc = 0,
+            .argc = 0,
+            .return_type = type,
+            .body = (Block) { .length = 1, .statements = body }
+        } }
+    };
+    return (IrConstant) {
+        .path = path,
+        .type = type,
+        .is_variable = false,
+        .is_thread_local = false,
+        .initializer = ir_lower_function(
+            &function, 0, symbols, checked, NULL, arena
+        ),
+        .is_evaluated = false
+    };
+}
+
+IrProgram ir_lower_program(SymbolTable* symbols, bool checked, Arena* arena) {
+    IrProgram p;
+    p.function_count = 0;
+    p.functions_bsize = 16;
+    p.functions = (IrFunction*) malloc(sizeof(IrFunction) * p.functions_bsize);
+    p.constant_count = 0;
+    p.constants_bsize = 4;
+    p.constants = (IrConstant*) malloc(sizeof(IrConstant) * p.constants_bsize);
+    for(size_t symboli = 0; symboli < symbols->count; symboli += 1) {
+        Symbol* symbol = symbols->symbols + symboli;
+        bool is_constant = symbol->node.type == CONSTANT_NODE;
+        bool is_global = symbol->node.type == GLOBAL_NODE;
+        if((is_constant || is_global) && symbol->variant_count > 0) {
+            if(p.constant_count + 1 > p.constants_bsize) {
+                p.constants_bsize *= 2;
+                p.constants = (IrConstant*) realloc(
+                    p.constants, sizeof(IrConstant) * p.constants_bsize
+                );
+            }
+            Node* n = symbol->variants;
+            IrConstant* c = p.constants + p.constant_count;
+            if(is_constant) {
+                *c = lower_constant(
+                    n->value.constant.path, n->value.constant.type,
+                    n->value.constant.value, symbols, checked, arena
+                );
+            } else {
+                *c = lower_constant(
+                    n->value.global.path, n->value.global.type,
+                    n->value.global.value, symbols, checked, arena
+                );
+                c->is_variable = true;
+                c->is_thread_local = n->value.global.is_thread_local;
+            }
+            p.constant_count += 1;
+        }
+        if(symbol->node.type != FUNCTION_NODE) { continue; }
+        for(size_t vari = 0; vari < symbol->variant_count; vari += 1) {
+            // the bodies of its 'par' loops are added first
+            IrFunction f = ir_lower_function(
+                symbol->variants + vari, vari, symbols, checked, &p, arena
+            );
+            program_add_function(&p, f);
+        }
+    }
+    return p;
+}
+
+IrFunction* ir_program_lookup(IrProgram* p, Namespace path, size_t variant) {
+    for(size_t fi = 0; fi < p->function_count; fi += 1) {
+        IrFunction* f = p->functions + fi;
+        if(f->variant == variant && namespace_eq(f->path, path)) { return f; }
+    }
+    return NULL;
+}
+
+IrConstant* ir_program_lookup_constant(IrProgram* p, Namespace path) {
+    for(size_t ci = 0; ci < p->constant_count; ci += 1) {
+        IrConstant* c = p->constants + ci;
+        if(namespace_eq(c->path, path)) { return c; }
+    }
+    return NULL;
+}
+
+void ir_program_free(IrProgram* p) {
+    for(size_t ci = 0; ci < p->constant_count; ci += 1) {
+        ir_function_free(&p->constants[ci].initializer);
+    }
+    free(p->constants);
+    for(size_t fi = 0; fi < p->function_count; fi += 1) {
+        ir_function_free(p->functions + fi);
+    }
+    free(p->functions);
+}
@@ -0,0 +1,334 @@
+#pragma once
+#include "symbols.h"
+
+
+typedef enum {
+    IR_VALUE_NONE,
+    IR_VALUE_LOCAL,
+    IR_VALUE_INTEGER,
+    IR_VALUE_FLOAT,
+    IR_VALUE_STRING,
+    IR_VALUE_BOOLEAN,
+    IR_VALUE_SIZE_OF
+} IrValueType;
+
+typedef struct IrValue {
+    IrValueType type;
+    Node* data_type;
+    union {
+        size_t local;
+        String literal;
+        Node* size_of;
+    } value;
+} IrValue;
+
+
+typedef enum {
+    IR_PROJECTION_MEMBER,
+    IR_PROJECTION_INDEX,
+    // element of the memory a slice points to
+    IR_PROJECTION_SLICE_INDEX,
+    // element of a vector
+    IR_PROJECTION_LANE
+} IrProjectionType;
+
+typedef struct IrProjection {
+    IrProjectionType type;
+    String member;
+    IrValue index;
+} IrProjection;
+
+typedef enum {
+    IR_PLACE_LOCAL,
+    IR_PLACE_DEREF,
+    // a 'const' declaration, which is never written
+    IR_PLACE_CONSTANT,
+    // a variable declared outside of functions
+    IR_PLACE_GLOBAL
+} IrPlaceType;
+
+typedef struct IrPlace {
+    IrPlaceType type;
+    Node* data_type;
+    union {
+        size_t local;
+        IrValue pointer;
+        Namespace constant;
+        Namespace global;
+    } base;
+    size_t projectionc;
+    IrProjection* projectionv;
+} IrPlace;
+
+
+// ordered from the strongest to the weakest guarantee
+typedef enum {
+    IR_CONST, // only depends on its arguments
+    IR_PURE, // may also read memory, but never writes it
+    IR_IMPURE
+} IrPurity;
+
+
+typedef enum {
+    IR_UNARY,
+    IR_BINARY,
+    IR_CONVERT,
+    IR_LOAD,
+    IR_STORE,
+    IR_ADDRESS_OF,
+    IR_CALL,
+    IR_RECORD,
+    IR_ARRAY,
+    IR_SLICE,
+    IR_PARALLEL,
+    // runs a new frame of an async function until it returns, suspending
+    // the (async) caller whenever the callee suspends
+    IR_AWAIT,
+    // suspends the async function until it is resumed
+    IR_YIELD,
+    // a 'task' holding a new frame of an async function, which is run by
+    // resuming the task
+    IR_TASK
+} IrInstructionType;
+
+typedef struct IrInstruction {
+    IrInstructionType type;
+    bool has_dest;
+    size_t dest;
+    union {
+        // 'op' is the node type of the source operation (NEGATION_NODE, ...)
+        struct { NodeType op; IrValue x; } unary;
+        struct { NodeType op; IrValue a; IrValue b; } binary;
+        struct { IrValue x; Node* to; } convert;
+        struct { IrPlace from; } load;
+        struct { IrPlace to; IrValue value; } store;
+        struct { IrPlace of; } address_of;
+        struct {
+            bool is_external;
+            Namespace path; size_t variant;
+            IrPurity purity;
+            String external_name;
+            size_t argc; IrValue* argv;
+        } call;
+        struct {
+            Node* type;
+            size_t argc; String* argnamev; IrValue* argv;
+        } record;
+        // remaining elements are zero
+        struct { Node* type; size_t valuec; IrValue* valuev; } array;
+        // the elements [start, end) of the memory at 'data'
+        struct {
+            Node* type; IrValue data; IrValue start; IrValue end;
+        } slice;
+        // calls the outlined body of a 'par' loop for parts of the indices
+        // [start, end) on multiple threads, passing it the captured values
+        struct {
+            Namespace path; size_t variant;
+            IrValue start; IrValue end;
+            size_t capturec; IrValue* capturev;
+        } parallel;
+        // the async function and its arguments for IR_AWAIT and IR_TASK
+        struct {
+            Namespace path; size_t variant;
+            size_t argc; IrValue* argv;
+        } coroutine;
+    } value;
+} IrInstruction;
+
+
+// jumps to 'to' for the values [low, high], which are sign extended for
+// signed types
+typedef struct IrSwitchCase {
+    uint64_t low;
+    uint64_t high;
+    size_t to;
+} IrSwitchCase;
+
+typedef enum {
+    IR_JUMP,
+    IR_BRANCH,
+    // jumps to the block of the case containing the value or to 'otherwise'
+    IR_SWITCH,
+    IR_RETURN,
+    IR_UNREACHABLE,
+    // a failed bounds check
+    IR_TRAP
+} IrTerminatorType;
+
+typedef struct IrTerminator {
+    IrTerminatorType type;
+    union {
+        struct { size_t to; } jump;
+        struct {
+            IrValue condition; size_t if_true; size_t if_false;
+        } branch;
+        struct {
+            IrValue value;
+            size_t casec; IrSwitchCase* casev;
+            size_t otherwise;
+        } switch_on;
+        struct { bool has_value; IrValue value; } return_value;
+    } value;
+} IrTerminator;
+
+
+typedef struct IrBlock {
+    size_t instruction_count;
+    IrInstruction* instructions;
+    size_t instructions_bsize;
+    IrTerminator terminator;
+} IrBlock;
+
+// the blocks of a loop are the contiguous range [header, end)
+typedef struct IrLoop {
+    size_t header;
+    size_t end;
+    // the hints given with 'with unroll 4 while ...'
+    Attributes attributes;
+} IrLoop;
+
+typedef struct IrLocal {
+    String name;
+    bool is_temporary;
+    bool is_argument;
+    bool is_address_taken;
+    // a large argument that is only read, which the code generator passes
+    // as a pointer to the value
+    bool is_by_pointer;
+    // a local of an async function that the code generator keeps in its
+    // frame, since it is used across a suspension point
+    bool is_in_frame;
+    // a pointer in a template variant that is only copied and compared,
+    // which the code generator declares as 'void*' so that variants only
+    // differing in what it points to emit the same C
+    bool is_opaque_pointer;
+    Node* type;
+} IrLocal;
+
+typedef struct IrFunction {
+    Namespace path;
+    size_t variant;
+    Node* return_type;
+    IrPurity purity;
+    // a large returned value, which the code generator writes to memory
+    // given by the caller
+    bool returns_by_pointer;
+    // a returned pointer declared as 'void*' (see 'is_opaque_pointer')
+    bool returns_opaque_pointer;
+    // the body of a 'par' loop, whose arguments are the captured values
+    // followed by the first and the end of the indices it runs
+    bool is_parallel_body;
+    // a coroutine, whose locals the code generator keeps in a frame that
+    // lives across the suspension points (IR_AWAIT and IR_YIELD)
+    bool is_async;
+    size_t argc;
+    size_t local_count;
+    IrLocal* locals;
+    size_t locals_bsize;
+    size_t block_count;
+    IrBlock* blocks;
+    size_t blocks_bsize;
+    size_t loop_count;
+    IrLoop* loops;
+    size_t loops_bsize;
+} IrFunction;
+
+bool ir_value_eq(IrValue* a, IrValue* b);
+bool ir_place_eq(IrPlace* a, IrPlace* b);
+// whether the place is in memory other code can reach (through a pointer or
+// as a global)
+bool ir_place_is_indirect(IrPlace* p);
+
+typedef struct IrVisitor {
+    void (*visit_value)(IrValue* v, void* data);
+    void (*visit_place)(IrPlace* p, void* data);
+    void* data;
+} IrVisitor;
+
+// calls the visitor on every place and operand value (including the
+// pointer operands of places), but not on instruction destinations
+void ir_visit_instruction(IrInstruction* i, IrVisitor* v);
+void ir_visit_terminator(IrTerminator* t, IrVisitor* v);
+
+
+size_t ir_add_local(IrFunction* f, IrLocal local);
+size_t ir_add_block(IrFunction* f);
+void ir_block_push(IrBlock* b, IrInstruction instruction);
+void ir_function_free(IrFunction* f);
+
+
+typedef enum {
+    IR_CONSTANT_NONE,
+    IR_CONSTANT_INTEGER,
+    IR_CONSTANT_FLOAT,
+    IR_CONSTANT_BOOLEAN,
+    // the members of a record or the elements of an array or vector
+    IR_CONSTANT_AGGREGATE
+} IrConstantValueType;
+
+typedef struct IrConstantValue {
+    IrConstantValueType type;
+    union {
+        // sign extended for signed types
+        uint64_t integer;
+        double floating;
+        bool boolean;
+        // 'names' are the member names for records and NULL otherwise
+        struct {
+            size_t count; String* names; struct IrConstantValue* values;
+        } aggregate;
+    } value;
+} IrConstantValue;
+
+// also used for global variables, which only start with the value
+typedef struct IrConstant {
+    Namespace path;
+    Node* type;
+    bool is_variable;
+    bool is_thread_local;
+    // a function without arguments returning the value
+    IrFunction initializer;
+    bool is_evaluated;
+    IrConstantValue value;
+} IrConstant;
+
+typedef struct IrProgram {
+    size_t function_count;
+    IrFunction* functions;
+    size_t functions_bsize;
+    size_t constant_count;
+    IrConstant* constants;
+    size_t constants_bsize;
+} IrProgram;
+
+// 'checked' inserts bounds checks for indexing and slicing, the bodies of
+// 'par' loops are added to 'program'
+IrFunction ir_lower_function(
+    Node* function, size_t variant, SymbolTable* symbols, bool checked,
+    IrProgram* program, Arena* arena
+);
+IrProgram ir_lower_program(SymbolTable* symbols, bool checked, Arena* arena);
+IrFunction* ir_program_lookup(IrProgram* p, Namespace path, size_t variant);
+IrConstant* ir_program_lookup_constant(IrProgram* p, Namespace path);
+void ir_program_free(IrProgram* p);
+
+
+IrPurity ir_external_purity(Node* external_function);
+
+
+bool ir_type_is_core(Node* type, const char* name);
+bool ir_type_is_unit(Node* type);
+bool ir_type_is_integer(Node* type);
+bool ir_type_is_float(Node* type);
+size_t ir_array_length(Node* array_type);
+bool ir_type_is_atomic(Node* type);
+bool ir_type_is_soa(Node* type);
+bool ir_type_is_task(Node* type);
+bool ir_type_is_vector(Node* type);
+size_t ir_vector_lanes(Node* vector_type);
+String ir_vector_element(Node* vector_type);
+// the pointer case of a union that only has it and a 'unit' case, which is
+// represented by the pointer alone (null for the other case), or 'casec'
+size_t ir_union_niche(Node* tagged_union);
+// the bits of the smallest unsigned integer that can hold the tag
+size_t ir_union_tag_bits(Node* tagged_union);
@@ -69,7 +69,11 @@ bool lexer_next(Lexer* l, Token* t_out) {
         TokenType type = INTEGER;
         while(end < l->src.length
             && is_digit(string_char_at(l->src, end))) { end += 1; }
-        if(string_char_at(l->src, end) == '.') {
+        // '0..5' is a range, not a float followed by a dot
+        bool is_fraction = end + 1 < l->src.length
+            && string_char_at(l->src, end) == '.'
+            && string_char_at(l->src, end + 1) != '.';
+        if(is_fraction) {
             type = FLOAT;
             end += 1;
             while(end < l->src.length
@@ -104,12 +108,21 @@ bool lexer_next(Lexer* l, Token* t_out) {
     LEX_KEYWORD("return", KEYWORD_RETURN)
     LEX_KEYWORD("ext", KEYWORD_EXT)
     LEX_KEYWORD("record", KEYWORD_RECORD)
+    LEX_KEYWORD("union", KEYWORD_UNION)
     LEX_KEYWORD("if", KEYWORD_IF)
     LEX_KEYWORD("else", KEYWORD_ELSE)
     LEX_KEYWORD("while", KEYWORD_WHILE)
+    LEX_KEYWORD("match", KEYWORD_MATCH)
+    LEX_KEYWORD("par", KEYWORD_PAR)
+    LEX_KEYWORD("async", KEYWORD_ASYNC)
+    LEX_KEYWORD("await", KEYWORD_AWAIT)
+    LEX_KEYWORD("yield", KEYWORD_YIELD)
     LEX_KEYWORD("var", KEYWORD_VAR)
+    LEX_KEYWORD("const", KEYWORD_CONST)
+    LEX_KEYWORD("restrict", KEYWORD_RESTRICT)
     LEX_KEYWORD("unit", KEYWORD_UNIT)
     LEX_KEYWORD("sizeof", KEYWORD_SIZEOF)
+    LEX_KEYWORD("with", KEYWORD_WITH)
     LEX_KEYWORD("true", BOOLEAN)
     LEX_KEYWORD("false", BOOLEAN)
     // other complex tokens
@@ -152,6 +165,7 @@ bool lexer_next(Lexer* l, Token* t_out) {
     LEX_MULTI("<=", LESS_THAN_EQUAL)
     LEX_MULTI(">=", GREATER_THAN_EQUAL)
     LEX_MULTI("::", DOUBLE_COLON)
+    LEX_MULTI("..", DOUBLE_DOT)
     // single-char tokens
     #define LEX_SINGLE(c, t) \
         case c: \
@@ -184,6 +198,7 @@ bool lexer_next(Lexer* l, Token* t_out) {
         LEX_SINGLE('@', AT)
         LEX_SINGLE('.', DOT)
         LEX_SINGLE(';', SEMICOLON)
+        LEX_SINGLE(',', COMMA)
     }
     panic("Unable to tokenize input!");
 }
@@ -44,7 +44,9 @@ typedef enum {
     AT,
     DOT,
     DOUBLE_COLON,
+    DOUBLE_DOT,
     SEMICOLON,
+    COMMA,
     KEYWORD_MOD,
     KEYWORD_USE,
     KEYWORD_AS,
@@ -53,12 +55,21 @@ typedef enum {
     KEYWORD_RETURN,
     KEYWORD_EXT,
     KEYWORD_RECORD,
+    KEYWORD_UNION,
     KEYWORD_IF,
     KEYWORD_ELSE,
     KEYWORD_WHILE,
+    KEYWORD_MATCH,
+    KEYWORD_PAR,
+    KEYWORD_ASYNC,
+    KEYWORD_AWAIT,
+    KEYWORD_YIELD,
     KEYWORD_VAR,
+    KEYWORD_CONST,
+    KEYWORD_RESTRICT,
     KEYWORD_UNIT,
-    KEYWORD_SIZEOF
+    KEYWORD_SIZEOF,
+    KEYWORD_WITH
 } TokenType;
 
 typedef struct {
@@ -2,6 +2,9 @@
 #include <stdio.h>
 #include "parser.h"
 #include "symbols.h"
+#include "ir.h"
+#include "evaluate.h"
+#include "optimize.h"
 #include "codegen.h"
 
 static String read_file(const char* path, Arena* arena) {
@@ -68,6 +71,8 @@ int main(int argc, const char** argv) {
     bool has_main = false;
     const char* output_file;
     bool has_output_file = false;
+    bool optimize = true;
+    bool checked = false;
     for(size_t argi = 1; argi < argc; argi += 1) {
         if(strcmp(argv[argi], "-m") == 0) {
             if(argi + 1 >= argc) { panic("Invalid CLI arguments!"); }
@@ -81,6 +86,12 @@ int main(int argc, const char** argv) {
             has_output_file = true;
             argi += 1;
             continue;
+        } else if(strcmp(argv[argi], "-O0") == 0) {
+            optimize = false;
+            continue;
+        } else if(strcmp(argv[argi], "-checked") == 0) {
+            checked = true;
+            continue;
         }
         String file = read_file(argv[argi], &arena);
         Lexer lexer = lexer_new(file);
@@ -98,9 +109,15 @@ int main(int argc, const char** argv) {
     if(has_main && !parse_path(main, &arena, &main_path)) {
         panic("Main path is invalid!");
     }
-    StringBuilder output = generate_code(&symbols, has_main? &main_path : NULL);
+    IrProgram program = ir_lower_program(&symbols, checked, &arena);
+    evaluate_constants(&program, &symbols, &arena);
+    if(optimize) { optimize_program(&program); }
+    StringBuilder output = generate_code(
+        &symbols, &program, has_main? &main_path : NULL
+    );
     write_file(output_file, output.length, output.buffer);
     stringbuilder_free(&output);
+    ir_program_free(&program);
     arena_free(&arena);
     s_table_free(&symbols);
 }
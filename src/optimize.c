@@ -0,0 +1,1075 @@
+#include "optimize.h"
+
+
+typedef struct {
+    IrFunction* f;
+    // number of definitions of each local, arguments are defined on entry
+    size_t* defs;
+    // 'dominators[b * block_count + d]' is true if 'd' dominates 'b'
+    bool* dominators;
+} Analysis;
+
+// 'out' needs space for as many blocks as the function has, since the
+// successors are distinct
+static size_t successors(IrTerminator* t, size_t* out) {
+    switch(t->type) {
+        case IR_JUMP:
+            out[0] = t->value.jump.to;
+            return 1;
+        case IR_BRANCH:
+            out[0] = t->value.branch.if_true;
+            out[1] = t->value.branch.if_false;
+            return 2;
+        case IR_SWITCH: {
+            size_t count = 0;
+            for(size_t ci = 0; ci <= t->value.switch_on.casec; ci += 1) {
+                size_t to = ci < t->value.switch_on.casec
+                    ? t->value.switch_on.casev[ci].to
+                    : t->value.switch_on.otherwise;
+                bool is_new = true;
+                for(size_t si = 0; si < count; si += 1) {
+                    if(out[si] == to) { is_new = false; }
+                }
+                if(is_new) { out[count] = to; count += 1; }
+            }
+            return count;
+        }
+        default:
+            return 0;
+    }
+}
+
+// whether the instruction writes to a local (as opposed to memory)
+static bool stores_local(IrInstruction* i, size_t* local) {
+    if(i->type != IR_STORE) { return false; }
+    IrPlace* to = &i->value.store.to;
+    if(ir_place_is_indirect(to)) { return false; }
+    *local = to->base.local;
+    return true;
+}
+
+static void count_definitions(Analysis* a) {
+    IrFunction* f = a->f;
+    for(size_t locali = 0; locali < f->local_count; locali += 1) {
+        a->defs[locali] = f->locals[locali].is_argument? 1 : 0;
+    }
+    for(size_t blocki = 0; blocki < f->block_count; blocki += 1) {
+        IrBlock* block = f->blocks + blocki;
+        for(size_t ii = 0; ii < block->instruction_count; ii += 1) {
+            IrInstruction* i = block->instructions + ii;
+            size_t stored;
+            if(i->has_dest) { a->defs[i->dest] += 1; }
+            if(stores_local(i, &stored)) { a->defs[stored] += 1; }
+        }
+    }
+}
+
+static void compute_dominators(Analysis* a) {
+    IrFunction* f = a->f;
+    size_t n = f->block_count;
+    size_t predc[n];
+    size_t pred_offset[n];
+    for(size_t blocki = 0; blocki < n; blocki += 1) { predc[blocki] = 0; }
+    size_t succv[f->block_count];
+    size_t edge_count = 0;
+    for(size_t blocki = 0; blocki < n; blocki += 1) {
+        size_t succc = successors(&f->blocks[blocki].terminator, succv);
+        for(size_t si = 0; si < succc; si += 1) { predc[succv[si]] += 1; }
+        edge_count += succc;
+    }
+    size_t offset = 0;
+    for(size_t blocki = 0; blocki < n; blocki += 1) {
+        pred_offset[blocki] = offset;
+        offset += predc[blocki];
+        predc[blocki] = 0;
+    }
+    size_t predv[edge_count + 1];
+    for(size_t blocki = 0; blocki < n; blocki += 1) {
+        size_t succc = successors(&f->blocks[blocki].terminator, succv);
+        for(size_t si = 0; si < succc; si += 1) {
+            size_t s = succv[si];
+            predv[pred_offset[s] + predc[s]] = blocki;
+            predc[s] += 1;
+        }
+    }
+    bool* dom = a->dominators;
+    for(size_t blocki = 0; blocki < n; blocki += 1) {
+        for(size_t d = 0; d < n; d += 1) {
+            dom[blocki * n + d] = blocki == 0? d == 0 : true;
+        }
+    }
+    bool changed = true;
+    while(changed) {
+        changed = false;
+        for(size_t blocki = 1; blocki < n; blocki += 1) {
+            if(predc[blocki] == 0) { continue; }
+            for(size_t d = 0; d < n; d += 1) {
+                bool is_dominator = d == blocki;
+                if(!is_dominator) {
+                    is_dominator = true;
+                    for(size_t pi = 0; pi < predc[blocki]; pi += 1) {
+                        size_t p = predv[pred_offset[blocki] + pi];
+                        if(!dom[p * n + d]) { is_dominator = false; break; }
+                    }
+                }
+                if(dom[blocki * n + d] != is_dominator) {
+                    dom[blocki * n + d] = is_dominator;
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+static Analysis analyze(IrFunction* f) {
+    Analysis a;
+    a.f = f;
+    a.defs = (size_t*) malloc(sizeof(size_t) * (f->local_count + 1));
+    a.dominators = (bool*) malloc(
+        sizeof(bool) * (f->block_count * f->block_count + 1)
+    );
+    count_definitions(&a);
+    compute_dominators(&a);
+    return a;
+}
+
+static void analysis_free(Analysis* a) {
+    free(a->defs);
+    free(a->dominators);
+}
+
+static bool dominates(Analysis* a, size_t d, size_t b) {
+    return a->dominators[b * a->f->block_count + d];
+}
+
+// a stable local always holds the value of its only definition
+static bool is_stable(Analysis* a, size_t local) {
+    return a->defs[local] == 1 && !a->f->locals[local].is_address_taken;
+}
+
+
+static bool namespace_eq(Namespace a, Namespace b) {
+    if(a.length != b.length) { return false; }
+    for(size_t elementi = 0; elementi < a.length; elementi += 1) {
+        if(!string_eq(a.elements[elementi], b.elements[elementi])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// plain reads and writes of an atomic value are sequentially consistent
+static bool is_atomic_access(IrInstruction* i) {
+    switch(i->type) {
+        case IR_LOAD:
+            return ir_type_is_atomic(i->value.load.from.data_type);
+        case IR_STORE:
+            return ir_type_is_atomic(i->value.store.to.data_type);
+        default:
+            return false;
+    }
+}
+
+// pure instructions only compute their destination
+static bool is_pure(IrInstruction* i) {
+    switch(i->type) {
+        case IR_LOAD:
+            return i->has_dest && !is_atomic_access(i);
+        case IR_UNARY:
+        case IR_BINARY:
+        case IR_CONVERT:
+        case IR_ADDRESS_OF:
+        case IR_SLICE:
+            return i->has_dest;
+        case IR_CALL:
+            return i->has_dest && i->value.call.purity != IR_IMPURE;
+        default:
+            return false;
+    }
+}
+
+static bool place_reads_memory(IrFunction* f, IrPlace* p) {
+    // constants never change
+    if(p->type == IR_PLACE_CONSTANT) { return false; }
+    return ir_place_is_indirect(p)
+        || f->locals[p->base.local].is_address_taken;
+}
+
+static bool reads_memory(IrFunction* f, IrInstruction* i) {
+    switch(i->type) {
+        case IR_LOAD:
+            return place_reads_memory(f, &i->value.load.from);
+        case IR_CALL:
+            return i->value.call.purity != IR_CONST;
+        case IR_PARALLEL:
+        case IR_AWAIT:
+        case IR_YIELD:
+        case IR_TASK:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// whether the instruction may change memory read through a pointer
+static bool clobbers_memory(IrFunction* f, IrInstruction* i) {
+    if(is_atomic_access(i)) { return true; }
+    switch(i->type) {
+        case IR_STORE:
+            return place_reads_memory(f, &i->value.store.to);
+        case IR_CALL:
+            return i->value.call.purity == IR_IMPURE;
+        case IR_PARALLEL:
+        case IR_AWAIT:
+        case IR_YIELD:
+        case IR_TASK:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// whether computing the instruction is fine even if its result is never used
+static bool may_speculate(IrInstruction* i) {
+    switch(i->type) {
+        case IR_BINARY:
+            switch(i->value.binary.op) {
+                case DIVISION_NODE:
+                case REMAINDER_NODE:
+                case LEFT_SHIFT_NODE:
+                case RIGHT_SHIFT_NODE:
+                    return false;
+                default:
+                    return true;
+            }
+        case IR_CONVERT:
+            return !ir_type_is_float(i->value.convert.x.data_type)
+                || ir_type_is_float(i->value.convert.to);
+        case IR_CALL:
+            // the called function may not terminate for all arguments
+            return false;
+        default:
+            return true;
+    }
+}
+
+
+typedef struct {
+    bool (*accept)(size_t local, void* data);
+    void* data;
+    bool result;
+} LocalCheck;
+
+static void check_value(IrValue* v, void* data) {
+    LocalCheck* c = (LocalCheck*) data;
+    if(v->type != IR_VALUE_LOCAL) { return; }
+    if(!c->accept(v->value.local, c->data)) { c->result = false; }
+}
+
+static void check_place(IrPlace* p, void* data) {
+    LocalCheck* c = (LocalCheck*) data;
+    if(p->type != IR_PLACE_LOCAL) { return; }
+    if(!c->accept(p->base.local, c->data)) { c->result = false; }
+}
+
+// whether 'accept' is true for every local read by the instruction
+static bool operands_all(
+    IrInstruction* i, bool (*accept)(size_t local, void* data), void* data
+) {
+    LocalCheck c = (LocalCheck) {
+        .accept = accept, .data = data, .result = true
+    };
+    IrVisitor v = (IrVisitor) {
+        .visit_value = &check_value, .visit_place = &check_place, .data = &c
+    };
+    ir_visit_instruction(i, &v);
+    return c.result;
+}
+
+
+static void substitute_value(IrValue* v, void* data) {
+    size_t* replace = (size_t*) data;
+    if(v->type != IR_VALUE_LOCAL) { return; }
+    v->value.local = replace[v->value.local];
+}
+
+static void substitute_place(IrPlace* p, void* data) {
+    size_t* replace = (size_t*) data;
+    if(p->type != IR_PLACE_LOCAL) { return; }
+    p->base.local = replace[p->base.local];
+}
+
+static bool is_commutative(NodeType op) {
+    switch(op) {
+        case ADDITION_NODE:
+        case MULTIPLICATION_NODE:
+        case BITWISE_AND_NODE:
+        case BITWISE_OR_NODE:
+        case BITWISE_XOR_NODE:
+        case EQUALS_NODE:
+        case NOT_EQUALS_NODE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool expression_eq(IrFunction* f, IrInstruction* a, IrInstruction* b) {
+    if(a->type != b->type) { return false; }
+    if(!template_arg_eq(f->locals[a->dest].type, f->locals[b->dest].type)) {
+        return false;
+    }
+    switch(a->type) {
+        case IR_UNARY:
+            return a->value.unary.op == b->value.unary.op
+                && ir_value_eq(&a->value.unary.x, &b->value.unary.x);
+        case IR_BINARY: {
+            if(a->value.binary.op != b->value.binary.op) { return false; }
+            if(ir_value_eq(&a->value.binary.a, &b->value.binary.a)
+                && ir_value_eq(&a->value.binary.b, &b->value.binary.b)) {
+                return true;
+            }
+            return is_commutative(a->value.binary.op)
+                && ir_value_eq(&a->value.binary.a, &b->value.binary.b)
+                && ir_value_eq(&a->value.binary.b, &b->value.binary.a);
+        }
+        case IR_CONVERT:
+            return ir_value_eq(&a->value.convert.x, &b->value.convert.x)
+                && template_arg_eq(a->value.convert.to, b->value.convert.to);
+        case IR_LOAD:
+            return ir_place_eq(&a->value.load.from, &b->value.load.from);
+        case IR_ADDRESS_OF:
+            return ir_place_eq(
+                &a->value.address_of.of, &b->value.address_of.of
+            );
+        case IR_SLICE:
+            return ir_value_eq(&a->value.slice.data, &b->value.slice.data)
+                && ir_value_eq(&a->value.slice.start, &b->value.slice.start)
+                && ir_value_eq(&a->value.slice.end, &b->value.slice.end);
+        case IR_CALL: {
+            if(a->value.call.is_external != b->value.call.is_external
+                || a->value.call.variant != b->value.call.variant
+                || !namespace_eq(a->value.call.path, b->value.call.path)
+                || a->value.call.argc != b->value.call.argc) {
+                return false;
+            }
+            for(size_t argi = 0; argi < a->value.call.argc; argi += 1) {
+                if(!ir_value_eq(
+                    a->value.call.argv + argi, b->value.call.argv + argi
+                )) { return false; }
+            }
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+
+typedef struct Available {
+    IrInstruction instruction;
+    size_t block;
+    size_t serial;
+    // only usable in its own block while its operands are unchanged
+    bool is_local;
+} Available;
+
+DEF_ARRAY_BUILDER(Available)
+
+typedef struct {
+    Analysis* a;
+    size_t* last_def;
+    size_t serial;
+} Unchanged;
+
+static bool local_is_stable(size_t local, void* data) {
+    return is_stable((Analysis*) data, local);
+}
+
+static bool local_unchanged(size_t local, void* data) {
+    Unchanged* u = (Unchanged*) data;
+    return u->last_def[local] <= u->serial;
+}
+
+static void remove_instruction(IrBlock* block, size_t ii) {
+    memmove(
+        block->instructions + ii, block->instructions + ii + 1,
+        sizeof(IrInstruction) * (block->instruction_count - ii - 1)
+    );
+    block->instruction_count -= 1;
+}
+
+// replaces pure instructions whose value has already been computed
+// (in the same block or in a dominating block) with that earlier result
+static bool eliminate_common_subexpressions(Analysis* a) {
+    IrFunction* f = a->f;
+    size_t replace[f->local_count + 1];
+    size_t last_def[f->local_count + 1];
+    for(size_t locali = 0; locali < f->local_count; locali += 1) {
+        replace[locali] = locali;
+        last_def[locali] = 0;
+    }
+    size_t serial = 0;
+    size_t last_clobber = 0;
+    IrVisitor substitute = (IrVisitor) {
+        .visit_value = &substitute_value, .visit_place = &substitute_place,
+        .data = replace
+    };
+    ArrayBuilder(Available) available = arraybuilder_new(Available)();
+    bool changed = false;
+    for(size_t blocki = 0; blocki < f->block_count; blocki += 1) {
+        IrBlock* block = f->blocks + blocki;
+        for(size_t ii = 0; ii < block->instruction_count;) {
+            IrInstruction* i = block->instructions + ii;
+            ir_visit_instruction(i, &substitute);
+            if(is_pure(i) && is_stable(a, i->dest)) {
+                Available* found = NULL;
+                Available* entries = (Available*) available.buffer;
+                for(size_t ei = 0; ei < available.length; ei += 1) {
+                    Available* e = entries + ei;
+                    if(!expression_eq(f, &e->instruction, i)) { continue; }
+                    if(e->block != blocki) {
+                        if(e->is_local || !dominates(a, e->block, blocki)) {
+                            continue;
+                        }
+                    } else {
+                        Unchanged u = (Unchanged) {
+                            .a = a, .last_def = last_def, .serial = e->serial
+                        };
+                        bool unchanged = local_unchanged(e->instruction.dest, &u)
+                            && operands_all(i, &local_unchanged, &u)
+                            && (!reads_memory(f, i) || last_clobber < e->serial);
+                        if(!unchanged) { continue; }
+                    }
+                    found = e;
+                    break;
+                }
+                if(found != NULL) {
+                    replace[i->dest] = found->instruction.dest;
+                    remove_instruction(block, ii);
+                    changed = true;
+                    continue;
+                }
+                arraybuilder_push(Available)(&available, (Available) {
+                    .instruction = *i,
+                    .block = blocki,
+                    .serial = serial + 1,
+                    .is_local = reads_memory(f, i)
+                        || !operands_all(i, &local_is_stable, a)
+                });
+            }
+            serial += 1;
+            size_t stored;
+            if(i->has_dest) { last_def[i->dest] = serial; }
+            if(stores_local(i, &stored)) { last_def[stored] = serial; }
+            if(clobbers_memory(f, i)) { last_clobber = serial; }
+            ii += 1;
+        }
+        ir_visit_terminator(&block->terminator, &substitute);
+    }
+    arraybuilder_discard(Available)(&available);
+    if(!changed) { return false; }
+    // uses may come before the replaced definition in block order
+    for(size_t blocki = 0; blocki < f->block_count; blocki += 1) {
+        IrBlock* block = f->blocks + blocki;
+        for(size_t ii = 0; ii < block->instruction_count; ii += 1) {
+            ir_visit_instruction(block->instructions + ii, &substitute);
+        }
+        ir_visit_terminator(&block->terminator, &substitute);
+    }
+    return true;
+}
+
+
+typedef struct {
+    Analysis* a;
+    bool* defined_in_loop;
+    bool loop_clobbers;
+} Invariance;
+
+static bool local_is_invariant(size_t local, void* data) {
+    Invariance* inv = (Invariance*) data;
+    if(inv->defined_in_loop[local]) { return false; }
+    return !inv->loop_clobbers || !inv->a->f->locals[local].is_address_taken;
+}
+
+static bool is_indexed(IrPlace* p) {
+    for(size_t pi = 0; pi < p->projectionc; pi += 1) {
+        if(p->projectionv[pi].type != IR_PROJECTION_MEMBER) { return true; }
+    }
+    return false;
+}
+
+static bool dereferences(IrBlock* block, IrValue* pointer) {
+    for(size_t ii = 0; ii < block->instruction_count; ii += 1) {
+        IrInstruction* i = block->instructions + ii;
+        IrPlace* place;
+        switch(i->type) {
+            case IR_LOAD: place = &i->value.load.from; break;
+            case IR_STORE: place = &i->value.store.to; break;
+            default: continue;
+        }
+        if(place->type != IR_PLACE_DEREF) { continue; }
+        if(ir_value_eq(&place->base.pointer, pointer)) { return true; }
+    }
+    return false;
+}
+
+static bool find_preheader(IrFunction* f, IrLoop* loop, size_t* preheader) {
+    bool found = false;
+    size_t succv[f->block_count];
+    for(size_t blocki = 0; blocki < f->block_count; blocki += 1) {
+        if(blocki >= loop->header && blocki < loop->end) { continue; }
+        size_t succc = successors(&f->blocks[blocki].terminator, succv);
+        for(size_t si = 0; si < succc; si += 1) {
+            if(succv[si] != loop->header) { continue; }
+            if(found || f->blocks[blocki].terminator.type != IR_JUMP) {
+                return false;
+            }
+            found = true;
+            *preheader = blocki;
+        }
+    }
+    return found;
+}
+
+// moves pure instructions that compute the same value in every iteration
+// of a loop into the block that enters the loop
+static bool hoist_loop_invariants(Analysis* a) {
+    IrFunction* f = a->f;
+    bool changed = false;
+    bool defined_in_loop[f->local_count + 1];
+    // inner loops come first, so values can move out of nested loops
+    for(size_t loopi = 0; loopi < f->loop_count; loopi += 1) {
+        IrLoop* loop = f->loops + loopi;
+        size_t preheader;
+        if(!find_preheader(f, loop, &preheader)) { continue; }
+        Invariance inv = (Invariance) {
+            .a = a, .defined_in_loop = defined_in_loop, .loop_clobbers = false
+        };
+        for(size_t locali = 0; locali < f->local_count; locali += 1) {
+            defined_in_loop[locali] = false;
+        }
+        for(size_t blocki = loop->header; blocki < loop->end; blocki += 1) {
+            IrBlock* block = f->blocks + blocki;
+            for(size_t ii = 0; ii < block->instruction_count; ii += 1) {
+                IrInstruction* i = block->instructions + ii;
+                size_t stored;
+                if(i->has_dest) { defined_in_loop[i->dest] = true; }
+                if(stores_local(i, &stored)) { defined_in_loop[stored] = true; }
+                if(clobbers_memory(f, i)) { inv.loop_clobbers = true; }
+            }
+        }
+        bool hoisted = true;
+        while(hoisted) {
+            hoisted = false;
+            for(size_t blocki = loop->header; blocki < loop->end; blocki += 1) {
+                IrBlock* block = f->blocks + blocki;
+                // the header is always executed when entering the loop,
+                // up to the first call that might not return
+                bool executes_on_entry = blocki == loop->header;
+                for(size_t ii = 0; ii < block->instruction_count;) {
+                    IrInstruction* i = block->instructions + ii;
+                    bool invariant = is_pure(i) && is_stable(a, i->dest)
+                        && (executes_on_entry || may_speculate(i))
+                        && operands_all(i, &local_is_invariant, &inv);
+                    if(invariant && reads_memory(f, i)) {
+                        invariant = !inv.loop_clobbers;
+                    }
+                    if(invariant && i->type == IR_LOAD && !executes_on_entry) {
+                        // the loaded location must be known to be valid
+                        // before the loop
+                        IrPlace* from = &i->value.load.from;
+                        invariant = !is_indexed(from)
+                            && (from->type != IR_PLACE_DEREF
+                                || dereferences(
+                                    f->blocks + loop->header,
+                                    &from->base.pointer
+                                )
+                                || dereferences(
+                                    f->blocks + preheader, &from->base.pointer
+                                ));
+                    }
+                    if(!invariant) {
+                        if(i->type == IR_CALL || i->type == IR_PARALLEL
+                            || i->type == IR_AWAIT || i->type == IR_YIELD) {
+                            executes_on_entry = false;
+                        }
+                        ii += 1;
+                        continue;
+                    }
+                    IrInstruction moved = *i;
+                    remove_instruction(block, ii);
+                    ir_block_push(f->blocks + preheader, moved);
+                    defined_in_loop[moved.dest] = false;
+                    hoisted = true;
+                    changed = true;
+                }
+            }
+        }
+    }
+    return changed;
+}
+
+
+// the comparison 'a < b' or 'a <= b' a block ends up branching on
+static IrInstruction* branch_comparison(IrBlock* block, size_t* at) {
+    IrTerminator* t = &block->terminator;
+    if(t->type != IR_BRANCH) { return NULL; }
+    if(t->value.branch.condition.type != IR_VALUE_LOCAL) { return NULL; }
+    size_t condition = t->value.branch.condition.value.local;
+    for(size_t ii = block->instruction_count; ii > 0; ii -= 1) {
+        IrInstruction* i = block->instructions + ii - 1;
+        size_t stored;
+        bool defines = (i->has_dest && i->dest == condition)
+            || (stores_local(i, &stored) && stored == condition);
+        if(!defines) { continue; }
+        bool is_comparison = i->type == IR_BINARY
+            && (i->value.binary.op == LESS_THAN_NODE
+                || i->value.binary.op == LESS_THAN_EQUAL_NODE);
+        if(!is_comparison) { return NULL; }
+        *at = ii - 1;
+        return i;
+    }
+    return NULL;
+}
+
+// the code executed after a guard branched to 'taken' and before a check
+typedef struct {
+    Analysis* a;
+    size_t guard;
+    size_t guard_at;
+    size_t check;
+    size_t check_at;
+    // blocks from which the check is reachable without passing the guard
+    bool* reaches_check;
+} Between;
+
+static void find_between(Between* b, size_t taken) {
+    IrFunction* f = b->a->f;
+    size_t n = f->block_count;
+    bool in_region[n];
+    size_t stack[n];
+    size_t stack_length = 0;
+    for(size_t blocki = 0; blocki < n; blocki += 1) {
+        in_region[blocki] = false;
+        b->reaches_check[blocki] = false;
+    }
+    in_region[taken] = true;
+    stack[0] = taken;
+    stack_length = 1;
+    size_t succv[f->block_count];
+    while(stack_length > 0) {
+        stack_length -= 1;
+        size_t blocki = stack[stack_length];
+        size_t succc = successors(&f->blocks[blocki].terminator, succv);
+        for(size_t si = 0; si < succc; si += 1) {
+            size_t s = succv[si];
+            if(s == b->guard || in_region[s]) { continue; }
+            in_region[s] = true;
+            stack[stack_length] = s;
+            stack_length += 1;
+        }
+    }
+    bool changed = true;
+    while(changed) {
+        changed = false;
+        for(size_t blocki = 0; blocki < n; blocki += 1) {
+            if(!in_region[blocki] || b->reaches_check[blocki]) { continue; }
+            size_t succc = successors(&f->blocks[blocki].terminator, succv);
+            for(size_t si = 0; si < succc; si += 1) {
+                size_t s = succv[si];
+                if(!in_region[s]) { continue; }
+                if(s != b->check && !b->reaches_check[s]) { continue; }
+                b->reaches_check[blocki] = true;
+                changed = true;
+            }
+        }
+    }
+}
+
+static bool defines_local(IrInstruction* i, size_t local) {
+    size_t stored;
+    return (i->has_dest && i->dest == local)
+        || (stores_local(i, &stored) && stored == local);
+}
+
+static bool unchanged_between(Between* b, size_t local) {
+    IrFunction* f = b->a->f;
+    if(is_stable(b->a, local)) { return true; }
+    if(f->locals[local].is_address_taken) { return false; }
+    for(size_t blocki = 0; blocki < f->block_count; blocki += 1) {
+        IrBlock* block = f->blocks + blocki;
+        size_t from = 0;
+        size_t to = block->instruction_count;
+        if(blocki == b->guard) {
+            from = b->guard_at + 1;
+        } else if(blocki == b->check) {
+            // unless the check is in a loop that does not contain the guard
+            if(!b->reaches_check[blocki]) { to = b->check_at; }
+        } else if(!b->reaches_check[blocki]) {
+            continue;
+        }
+        for(size_t ii = from; ii < to; ii += 1) {
+            if(defines_local(block->instructions + ii, local)) { return false; }
+        }
+    }
+    return true;
+}
+
+static IrInstruction* only_definition(Analysis* a, size_t local) {
+    if(!is_stable(a, local)) { return NULL; }
+    IrFunction* f = a->f;
+    for(size_t blocki = 0; blocki < f->block_count; blocki += 1) {
+        IrBlock* block = f->blocks + blocki;
+        for(size_t ii = 0; ii < block->instruction_count; ii += 1) {
+            IrInstruction* i = block->instructions + ii;
+            if(i->has_dest && i->dest == local) { return i; }
+        }
+    }
+    return NULL;
+}
+
+// whether an operand of the check has the value of the guard's operand
+static bool same_operand(Between* b, IrValue* guard, IrValue* check) {
+    if(ir_value_eq(guard, check)) {
+        return guard->type != IR_VALUE_LOCAL
+            || unchanged_between(b, guard->value.local);
+    }
+    // separate loads of a local that never changes, like a slice length
+    if(guard->type != IR_VALUE_LOCAL || check->type != IR_VALUE_LOCAL) {
+        return false;
+    }
+    IrInstruction* guard_def = only_definition(b->a, guard->value.local);
+    IrInstruction* check_def = only_definition(b->a, check->value.local);
+    if(guard_def == NULL || guard_def->type != IR_LOAD) { return false; }
+    if(check_def == NULL || check_def->type != IR_LOAD) { return false; }
+    IrPlace* from = &guard_def->value.load.from;
+    return ir_place_eq(from, &check_def->value.load.from)
+        && from->type == IR_PLACE_LOCAL && !is_indexed(from)
+        && is_stable(b->a, from->base.local);
+}
+
+// removes bounds checks that are implied by a dominating comparison, like
+// the condition of a loop going over the indices of a slice
+static bool eliminate_redundant_checks(Analysis* a) {
+    IrFunction* f = a->f;
+    size_t n = f->block_count;
+    size_t predc[n];
+    bool reaches_check[n];
+    for(size_t blocki = 0; blocki < n; blocki += 1) { predc[blocki] = 0; }
+    size_t succv[f->block_count];
+    for(size_t blocki = 0; blocki < n; blocki += 1) {
+        size_t succc = successors(&f->blocks[blocki].terminator, succv);
+        for(size_t si = 0; si < succc; si += 1) { predc[succv[si]] += 1; }
+    }
+    bool changed = false;
+    for(size_t blocki = 0; blocki < n; blocki += 1) {
+        IrBlock* block = f->blocks + blocki;
+        size_t check_at;
+        IrInstruction* check = branch_comparison(block, &check_at);
+        if(check == NULL) { continue; }
+        IrBlock* fail = f->blocks + block->terminator.value.branch.if_false;
+        if(fail->terminator.type != IR_TRAP || fail->instruction_count > 0) {
+            continue;
+        }
+        for(size_t guardi = 0; guardi < n; guardi += 1) {
+            if(guardi == blocki || !dominates(a, guardi, blocki)) { continue; }
+            size_t guard_at;
+            IrInstruction* guard = branch_comparison(
+                f->blocks + guardi, &guard_at
+            );
+            if(guard == NULL) { continue; }
+            // 'a < b' implies both checks, 'a <= b' only the inclusive one
+            if(guard->value.binary.op == LESS_THAN_EQUAL_NODE
+                && check->value.binary.op == LESS_THAN_NODE) { continue; }
+            // the check must only be reachable when the guard held
+            size_t taken = f->blocks[guardi].terminator.value.branch.if_true;
+            if(taken == guardi || predc[taken] != 1
+                || !dominates(a, taken, blocki)) { continue; }
+            Between b = (Between) {
+                .a = a,
+                .guard = guardi, .guard_at = guard_at,
+                .check = blocki, .check_at = check_at,
+                .reaches_check = reaches_check
+            };
+            find_between(&b, taken);
+            if(taken != blocki && !reaches_check[taken]) { continue; }
+            bool implied = same_operand(
+                    &b, &guard->value.binary.a, &check->value.binary.a
+                )
+                && same_operand(
+                    &b, &guard->value.binary.b, &check->value.binary.b
+                );
+            if(!implied) { continue; }
+            block->terminator = (IrTerminator) {
+                .type = IR_JUMP,
+                .value = { .jump = {
+                    .to = block->terminator.value.branch.if_true
+                } }
+            };
+            changed = true;
+            break;
+        }
+    }
+    return changed;
+}
+
+
+static void count_value_use(IrValue* v, void* data) {
+    size_t* uses = (size_t*) data;
+    if(v->type == IR_VALUE_LOCAL) { uses[v->value.local] += 1; }
+}
+
+static void count_place_use(IrPlace* p, void* data) {
+    size_t* uses = (size_t*) data;
+    if(p->type == IR_PLACE_LOCAL) { uses[p->base.local] += 1; }
+}
+
+// removes instructions that only write temporaries that are never read
+static void eliminate_dead_code(IrFunction* f) {
+    size_t uses[f->local_count + 1];
+    IrVisitor count = (IrVisitor) {
+        .visit_value = &count_value_use, .visit_place = &count_place_use,
+        .data = uses
+    };
+    bool changed = true;
+    while(changed) {
+        changed = false;
+        for(size_t locali = 0; locali < f->local_count; locali += 1) {
+            uses[locali] = 0;
+        }
+        for(size_t blocki = 0; blocki < f->block_count; blocki += 1) {
+            IrBlock* block = f->blocks + blocki;
+            for(size_t ii = 0; ii < block->instruction_count; ii += 1) {
+                IrInstruction* i = block->instructions + ii;
+                size_t stored;
+                if(stores_local(i, &stored)) {
+                    // writing to a local is not a use of it
+                    IrPlace* to = &i->value.store.to;
+                    for(size_t pi = 0; pi < to->projectionc; pi += 1) {
+                        IrProjection* projection = to->projectionv + pi;
+                        if(projection->type == IR_PROJECTION_INDEX) {
+                            count_value_use(&projection->index, uses);
+                        }
+                    }
+                    count_value_use(&i->value.store.value, uses);
+                    continue;
+                }
+                ir_visit_instruction(i, &count);
+            }
+            ir_visit_terminator(&block->terminator, &count);
+        }
+        for(size_t blocki = 0; blocki < f->block_count; blocki += 1) {
+            IrBlock* block = f->blocks + blocki;
+            for(size_t ii = 0; ii < block->instruction_count;) {
+                IrInstruction* i = block->instructions + ii;
+                size_t written;
+                bool removable = false;
+                bool is_construction = i->type == IR_RECORD
+                    || i->type == IR_ARRAY;
+                if(is_pure(i) || (is_construction && i->has_dest)) {
+                    written = i->dest;
+                    removable = true;
+                } else if(stores_local(i, &written)) {
+                    removable = true;
+                }
+                IrLocal* local = removable? f->locals + written : NULL;
+                if(!removable || !local->is_temporary
+                    || local->is_address_taken || uses[written] > 0) {
+                    ii += 1;
+                    continue;
+                }
+                remove_instruction(block, ii);
+                changed = true;
+            }
+        }
+    }
+}
+
+
+static IrPurity max_purity(IrPurity a, IrPurity b) {
+    return a > b? a : b;
+}
+
+static IrPurity call_purity(IrProgram* p, IrInstruction* call) {
+    if(call->value.call.is_external) { return call->value.call.purity; }
+    IrFunction* called = ir_program_lookup(
+        p, call->value.call.path, call->value.call.variant
+    );
+    return called == NULL? IR_IMPURE : called->purity;
+}
+
+// whether the blocks of the function can run in a cycle (a loop or a self
+// tail call jumping back to the start), which is the case if a depth-first
+// search finds an edge to a block on its current path
+static bool has_back_edge(IrFunction* f) {
+    size_t n = f->block_count;
+    if(n == 0) { return false; }
+    // 0 for unvisited blocks, 1 for blocks on the current path and 2 for
+    // finished ones
+    uint8_t* state = (uint8_t*) calloc(n, sizeof(uint8_t));
+    // the blocks on the path, each followed by the number of its successors
+    // that have been visited
+    size_t* path = (size_t*) malloc(sizeof(size_t) * n * 2);
+    size_t* succv = (size_t*) malloc(sizeof(size_t) * n);
+    size_t depth = 1;
+    path[0] = 0;
+    path[1] = 0;
+    state[0] = 1;
+    bool found = false;
+    while(depth > 0 && !found) {
+        size_t* top = path + (depth - 1) * 2;
+        size_t succc = successors(&f->blocks[top[0]].terminator, succv);
+        if(top[1] == succc) {
+            state[top[0]] = 2;
+            depth -= 1;
+            continue;
+        }
+        size_t next = succv[top[1]];
+        top[1] += 1;
+        if(state[next] == 1) { found = true; }
+        if(state[next] != 0) { continue; }
+        state[next] = 1;
+        path[depth * 2] = next;
+        path[depth * 2 + 1] = 0;
+        depth += 1;
+    }
+    free(state);
+    free(path);
+    free(succv);
+    return found;
+}
+
+// whether the function calls itself through any chain of calls
+static bool is_recursive(IrProgram* p, IrFunction* f) {
+    bool reached[p->function_count];
+    for(size_t fi = 0; fi < p->function_count; fi += 1) {
+        reached[fi] = false;
+    }
+    // the functions whose calls have not been visited yet
+    size_t* pending = (size_t*) malloc(
+        sizeof(size_t) * (p->function_count + 1)
+    );
+    size_t pending_count = 1;
+    pending[0] = f - p->functions;
+    while(pending_count > 0) {
+        pending_count -= 1;
+        IrFunction* caller = p->functions + pending[pending_count];
+        for(size_t blocki = 0; blocki < caller->block_count; blocki += 1) {
+            IrBlock* block = caller->blocks + blocki;
+            for(size_t ii = 0; ii < block->instruction_count; ii += 1) {
+                IrInstruction* i = block->instructions + ii;
+                if(i->type != IR_CALL || i->value.call.is_external) {
+                    continue;
+                }
+                IrFunction* called = ir_program_lookup(
+                    p, i->value.call.path, i->value.call.variant
+                );
+                if(called == NULL) { continue; }
+                size_t calledi = called - p->functions;
+                if(reached[calledi]) { continue; }
+                reached[calledi] = true;
+                pending[pending_count] = calledi;
+                pending_count += 1;
+            }
+        }
+    }
+    free(pending);
+    return reached[f - p->functions];
+}
+
+// the purity of a function body, given the current purity of the functions
+// it calls
+static IrPurity body_purity(IrProgram* p, IrFunction* f) {
+    IrPurity purity = IR_CONST;
+    for(size_t blocki = 0; blocki < f->block_count; blocki += 1) {
+        IrBlock* block = f->blocks + blocki;
+        for(size_t ii = 0; ii < block->instruction_count; ii += 1) {
+            IrInstruction* i = block->instructions + ii;
+            if(is_atomic_access(i)) { return IR_IMPURE; }
+            switch(i->type) {
+                case IR_LOAD:
+                    // locals are not visible to the caller
+                    if(ir_place_is_indirect(&i->value.load.from)) {
+                        purity = max_purity(purity, IR_PURE);
+                    }
+                    break;
+                case IR_STORE:
+                    if(ir_place_is_indirect(&i->value.store.to)) {
+                        return IR_IMPURE;
+                    }
+                    break;
+                case IR_CALL:
+                    purity = max_purity(purity, call_purity(p, i));
+                    break;
+                case IR_PARALLEL:
+                    // the body runs on other threads
+                    return IR_IMPURE;
+                case IR_AWAIT:
+                case IR_YIELD:
+                case IR_TASK:
+                    // the caller sees the frame
+                    return IR_IMPURE;
+            }
+            if(purity == IR_IMPURE) { return IR_IMPURE; }
+        }
+    }
+    return purity;
+}
+
+// classifies every function as const, pure or impure, starting from the
+// assumption that all of them are const (except the ones that may never
+// return)
+void infer_purity(IrProgram* p) {
+    for(size_t fi = 0; fi < p->function_count; fi += 1) {
+        IrFunction* f = p->functions + fi;
+        // functions that may never return must not be removed or merged,
+        // and recursion would otherwise pass the assumption on to itself
+        bool may_not_return = has_back_edge(f) || is_recursive(p, f);
+        f->purity = may_not_return? IR_IMPURE : IR_CONST;
+    }
+    bool changed = true;
+    while(changed) {
+        changed = false;
+        for(size_t fi = 0; fi < p->function_count; fi += 1) {
+            IrFunction* f = p->functions + fi;
+            if(f->purity == IR_IMPURE) { continue; }
+            IrPurity purity = body_purity(p, f);
+            if(purity == f->purity) { continue; }
+            f->purity = purity;
+            changed = true;
+        }
+    }
+    for(size_t fi = 0; fi < p->function_count; fi += 1) {
+        IrFunction* f = p->functions + fi;
+        for(size_t blocki = 0; blocki < f->block_count; blocki += 1) {
+            IrBlock* block = f->blocks + blocki;
+            for(size_t ii = 0; ii < block->instruction_count; ii += 1) {
+                IrInstruction* i = block->instructions + ii;
+                if(i->type != IR_CALL) { continue; }
+                i->value.call.purity = call_purity(p, i);
+            }
+        }
+    }
+}
+
+
+void optimize_function(IrFunction* f) {
+    Analysis a = analyze(f);
+    eliminate_common_subexpressions(&a);
+    if(hoist_loop_invariants(&a)) {
+        // hoisted values may now repeat values computed before the loop
+        eliminate_common_subexpressions(&a);
+    }
+    eliminate_redundant_checks(&a);
+    eliminate_dead_code(f);
+    analysis_free(&a);
+}
+
+void optimize_program(IrProgram* p) {
+    infer_purity(p);
+    for(size_t fi = 0; fi < p->function_count; fi += 1) {
+        optimize_function(p->functions + fi);
+    }
+}
@@ -0,0 +1,7 @@
+#pragma once
+#include "ir.h"
+
+
+void infer_purity(IrProgram* p);
+void optimize_function(IrFunction* f);
+void optimize_program(IrProgram* p);
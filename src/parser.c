@@ -5,6 +5,10 @@
 DEF_ARRAY_BUILDER(String)
 DEF_ARRAY_BUILDER(Node)
 DEF_ARRAY_BUILDER(Namespace)
+DEF_ARRAY_BUILDER(Attribute)
+DEF_ARRAY_BUILDER(Attributes)
+DEF_ARRAY_BUILDER(MatchPattern)
+DEF_ARRAY_BUILDER(MatchArm)
 
 
 Parser parser_new(Arena* a) {
@@ -69,7 +73,23 @@ static Node parse_identifier(Parser* p, Lexer* l, bool force_namespace) {
             EXPECT_NEXT();
             ArrayBuilder(Node) b = arraybuilder_new(Node)();
             while(CURRENT.type != BRACKET_CLOSE) {
-                Node template_arg = PARSE_TYPE();
+                Node template_arg;
+                // values of value parameters
+                if(CURRENT.type == INTEGER) {
+                    template_arg = CREATE_NODE(
+                        INTEGER_LITERAL_NODE, integer_literal,
+                        .value = CURRENT.content
+                    );
+                    EXPECT_NEXT();
+                } else if(CURRENT.type == BOOLEAN) {
+                    template_arg = CREATE_NODE(
+                        BOOLEAN_LITERAL_NODE, boolean_literal,
+                        .value = CURRENT.content
+                    );
+                    EXPECT_NEXT();
+                } else {
+                    template_arg = PARSE_TYPE();
+                }
                 arraybuilder_push(Node)(&b, template_arg);
             }
             TRY_NEXT();
@@ -99,9 +119,54 @@ static Node parse_type(Parser* p, Lexer* l) {
             return parse_identifier(p, l, true);
         case AMPERSAND:
             EXPECT_NEXT();
+            bool is_const = false;
+            bool is_restrict = false;
+            while(CURRENT.type == KEYWORD_CONST
+                || CURRENT.type == KEYWORD_RESTRICT) {
+                bool* qualifier = CURRENT.type == KEYWORD_CONST
+                    ? &is_const : &is_restrict;
+                if(*qualifier) { panic("Repeated pointer qualifier!"); }
+                *qualifier = true;
+                EXPECT_NEXT();
+            }
             Node pointed_to = PARSE_TYPE();
             return CREATE_NODE(POINTER_TYPE_NODE, pointer_type,
-                .to = ALLOC_NODE(pointed_to)
+                .to = ALLOC_NODE(pointed_to), .is_const = is_const,
+                .is_restrict = is_restrict
+            );
+        case BRACKET_OPEN:
+            EXPECT_NEXT();
+            if(CURRENT.type == BRACKET_CLOSE) {
+                EXPECT_NEXT();
+                Node slice_element = PARSE_TYPE();
+                return CREATE_NODE(SLICE_TYPE_NODE, slice_type,
+                    .of = ALLOC_NODE(slice_element)
+                );
+            }
+            Node array_length;
+            if(CURRENT.type == IDENTIFIER) {
+                // a value parameter, replaced by its value when monomorphized
+                String* name = (String*) arena_alloc(p->arena, sizeof(String));
+                *name = CURRENT.content;
+                array_length = CREATE_NODE(
+                    NAMESPACE_ACCESS_NODE, namespace_access,
+                    .path = (Namespace) { .length = 1, .elements = name },
+                    .template_argc = 0
+                );
+            } else {
+                EXPECT_TYPE(INTEGER);
+                array_length = CREATE_NODE(
+                    INTEGER_LITERAL_NODE, integer_literal,
+                    .value = CURRENT.content
+                );
+            }
+            EXPECT_NEXT();
+            EXPECT_TYPE(BRACKET_CLOSE);
+            EXPECT_NEXT();
+            Node array_element = PARSE_TYPE();
+            return CREATE_NODE(ARRAY_TYPE_NODE, array_type,
+                .length = ALLOC_NODE(array_length),
+                .of = ALLOC_NODE(array_element)
             );
     }
     PARSING_ERROR();
@@ -116,6 +181,7 @@ static Node parse_type(Parser* p, Lexer* l) {
 #define P_DEREF 2
 #define P_ADDRESS_OF 2
 #define P_SIZE_OF 2
+#define P_AWAIT 2
 #define P_TYPE_CONVERSION 3
 #define P_MULTIPLICATION 4
 #define P_DIVISION 4
@@ -156,11 +222,16 @@ static uint8_t infix_operator_precedence(TokenType t) {
         case AMPERSAND: return P_BITWISE_AND;
         case CARET: return P_BITWISE_XOR;
         case PIPE: return P_BITWISE_OR;
+        case DOUBLE_AMPERSAND: return P_LOGICAL_AND;
+        case DOUBLE_PIPE: return P_LOGICAL_OR;
         case EQUALS:
         case BRACE_OPEN:
         case BRACE_CLOSE:
         case SEMICOLON:
         case PAREN_CLOSE:
+        case BRACKET_CLOSE:
+        case COMMA:
+        case DOUBLE_DOT:
             return P_EXPRESSION_TERMINATOR;
     }
     return P_NONE;
@@ -262,6 +333,35 @@ static Node parse_expression(Parser* p, Lexer* l, uint8_t precedence) {
                 EXPECT_HAS_PREVIOUS();
                 Node accessed_record = previous;
                 EXPECT_NEXT();
+                if(CURRENT.type == BRACKET_OPEN) {
+                    EXPECT_NEXT();
+                    Node* index = NULL;
+                    if(CURRENT.type != DOUBLE_DOT) {
+                        index = ALLOC_NODE(PARSE_EXPRESSION());
+                    }
+                    if(index != NULL && CURRENT.type == BRACKET_CLOSE) {
+                        TRY_NEXT();
+                        previous = CREATE_NODE(INDEX_NODE, index,
+                            .x = ALLOC_NODE(accessed_record), .index = index
+                        );
+                        has_previous = true;
+                        continue;
+                    }
+                    EXPECT_TYPE(DOUBLE_DOT);
+                    EXPECT_NEXT();
+                    Node* slice_end = NULL;
+                    if(CURRENT.type != BRACKET_CLOSE) {
+                        slice_end = ALLOC_NODE(PARSE_EXPRESSION());
+                    }
+                    EXPECT_TYPE(BRACKET_CLOSE);
+                    TRY_NEXT();
+                    previous = CREATE_NODE(SLICE_NODE, slice,
+                        .x = ALLOC_NODE(accessed_record),
+                        .start = index, .end = slice_end
+                    );
+                    has_previous = true;
+                    continue;
+                }
                 EXPECT_TYPE(IDENTIFIER);
                 String member_name = CURRENT.content;
                 TRY_NEXT();
@@ -354,6 +454,13 @@ static Node parse_expression(Parser* p, Lexer* l, uint8_t precedence) {
                     .x = ALLOC_NODE(referenced)
                 );
                 break;
+            case KEYWORD_AWAIT:
+                EXPECT_NEXT();
+                Node awaited = PARSE_EXPRESSION_WITH(P_AWAIT);
+                node = CREATE_NODE(AWAIT_NODE, await,
+                    .call = ALLOC_NODE(awaited)
+                );
+                break;
             case KEYWORD_SIZEOF:
                 EXPECT_NEXT();
                 Node queried_type = PARSE_TYPE();
@@ -367,6 +474,22 @@ static Node parse_expression(Parser* p, Lexer* l, uint8_t precedence) {
                 EXPECT_TYPE(PAREN_CLOSE);
                 TRY_NEXT();
                 break;
+            case BRACKET_OPEN:
+                EXPECT_NEXT();
+                ArrayBuilder(Node) eb = arraybuilder_new(Node)();
+                while(CURRENT.type != BRACKET_CLOSE) {
+                    Node element = PARSE_EXPRESSION();
+                    arraybuilder_push(Node)(&eb, element);
+                    if(CURRENT.type != COMMA) { break; }
+                    EXPECT_NEXT();
+                }
+                EXPECT_TYPE(BRACKET_CLOSE);
+                TRY_NEXT();
+                node = CREATE_NODE(ARRAY_LITERAL_NODE, array_literal,
+                    .valuec = eb.length,
+                    .valuev = (Node*) arraybuilder_finish(Node)(&eb, p->arena)
+                );
+                break;
             default:
                 PARSING_ERROR();
         }
@@ -447,6 +570,250 @@ static Namespace* parse_usages(Parser* p, Lexer* l, size_t* pathc) {
     }
 }
 
+static Attribute parse_attribute(Parser* p, Lexer* l) {
+    // 'const' is also a keyword
+    EXPECT(CURRENT.type == IDENTIFIER || CURRENT.type == KEYWORD_CONST);
+    Attribute attribute = (Attribute) {
+        .name = CURRENT.content, .has_value = false
+    };
+    EXPECT_NEXT();
+    if(CURRENT.type == INTEGER) {
+        attribute.has_value = true;
+        attribute.value = CURRENT.content;
+        EXPECT_NEXT();
+    }
+    return attribute;
+}
+
+static Attributes parse_attributes(Parser* p, Lexer* l) {
+    ArrayBuilder(Attribute) b = arraybuilder_new(Attribute)();
+    while(CURRENT.type == IDENTIFIER || CURRENT.type == KEYWORD_CONST) {
+        arraybuilder_push(Attribute)(&b, parse_attribute(p, l));
+    }
+    EXPECT(b.length > 0);
+    Attributes result;
+    result.length = b.length;
+    result.attributes = (Attribute*) arraybuilder_finish(Attribute)(
+        &b, p->arena
+    );
+    return result;
+}
+
+// 'known' is terminated by NULL
+static void check_attributes(Attributes* a, const char** known) {
+    for(size_t ai = 0; ai < a->length; ai += 1) {
+        bool is_known = false;
+        for(size_t ki = 0; known[ki] != NULL; ki += 1) {
+            if(string_eq(a->attributes[ai].name, string_wrap_nt(known[ki]))) {
+                is_known = true;
+            }
+        }
+        if(!is_known) { panic("Unknown attribute!"); }
+    }
+}
+
+// 'align N' needs a power of two, other attributes take no value
+static void check_alignment(Attributes* a) {
+    for(size_t ai = 0; ai < a->length; ai += 1) {
+        Attribute* attribute = a->attributes + ai;
+        bool is_align = string_eq(attribute->name, string_wrap_nt("align"));
+        if(is_align != attribute->has_value) {
+            panic("Only 'align' takes a value!");
+        }
+        if(!is_align) { continue; }
+        STRING_AS_NT(attribute->value, digits);
+        uint64_t alignment = strtoull(digits, NULL, 10);
+        if(alignment == 0 || (alignment & (alignment - 1)) != 0) {
+            panic("Alignment must be a power of two!");
+        }
+    }
+}
+
+// 'unroll N' and 'likely_trip N' need a positive count, other loop
+// attributes take no value
+static void check_loop_attributes(Attributes* a) {
+    for(size_t ai = 0; ai < a->length; ai += 1) {
+        Attribute* attribute = a->attributes + ai;
+        bool is_count = string_eq(attribute->name, string_wrap_nt("unroll"))
+            || string_eq(attribute->name, string_wrap_nt("likely_trip"));
+        if(is_count != attribute->has_value) {
+            panic("Only 'unroll' and 'likely_trip' take a value!");
+        }
+        if(!is_count) { continue; }
+        STRING_AS_NT(attribute->value, digits);
+        uint64_t count = strtoull(digits, NULL, 10);
+        if(count == 0 || count > 65534) {
+            panic("Loop counts must be between 1 and 65534!");
+        }
+    }
+}
+
+static void check_function_attributes(Attributes* a) {
+    for(size_t ai = 0; ai < a->length; ai += 1) {
+        if(a->attributes[ai].has_value) {
+            panic("Function attributes take no value!");
+        }
+    }
+    bool is_inline = attributes_find(a, "inline") != NULL;
+    bool is_noinline = attributes_find(a, "noinline") != NULL;
+    bool is_hot = attributes_find(a, "hot") != NULL;
+    bool is_cold = attributes_find(a, "cold") != NULL;
+    if((is_inline && is_noinline) || (is_hot && is_cold)) {
+        panic("Conflicting function attributes!");
+    }
+}
+
+Attribute* attributes_find(Attributes* a, const char* name) {
+    for(size_t ai = 0; ai < a->length; ai += 1) {
+        if(string_eq(a->attributes[ai].name, string_wrap_nt(name))) {
+            return a->attributes + ai;
+        }
+    }
+    return NULL;
+}
+
+static bool is_value_parameter_type(String name) {
+    const char* types[] = {
+        "u8", "u16", "u32", "u64", "usize",
+        "s8", "s16", "s32", "s64", "ssize", "bool", NULL
+    };
+    for(size_t ti = 0; types[ti] != NULL; ti += 1) {
+        if(string_eq(name, string_wrap_nt(types[ti]))) { return true; }
+    }
+    return false;
+}
+
+// parses '[T N usize ...]', where a name followed by an integer type or
+// 'bool' is a value parameter
+static size_t parse_template_parameters(
+    Parser* p, Lexer* l, String** namev, Node** typev
+) {
+    EXPECT_NEXT();
+    ArrayBuilder(String) nb = arraybuilder_new(String)();
+    ArrayBuilder(Node) tb = arraybuilder_new(Node)();
+    while(CURRENT.type != BRACKET_CLOSE) {
+        EXPECT_TYPE(IDENTIFIER);
+        arraybuilder_push(String)(&nb, CURRENT.content);
+        EXPECT_NEXT();
+        Node type = CREATE_EMPTY_NODE(UNIT_LITERAL_NODE);
+        if(CURRENT.type == IDENTIFIER
+            && is_value_parameter_type(CURRENT.content)) {
+            type = PARSE_TYPE();
+        }
+        arraybuilder_push(Node)(&tb, type);
+    }
+    EXPECT_NEXT();
+    size_t count = nb.length;
+    *namev = (String*) arraybuilder_finish(String)(&nb, p->arena);
+    *typev = (Node*) arraybuilder_finish(Node)(&tb, p->arena);
+    return count;
+}
+
+// variables declared outside of functions are globals
+static Node global_from_declaration(
+    Parser* p, Node declaration, bool is_public
+) {
+    String* name = (String*) arena_alloc(p->arena, sizeof(String));
+    *name = declaration.value.variable_declaration.name;
+    return CREATE_NODE(GLOBAL_NODE, global,
+        .is_public = is_public, .is_thread_local = false,
+        .path = (Namespace) { .length = 1, .elements = name },
+        .type = declaration.value.variable_declaration.type,
+        .value = declaration.value.variable_declaration.value
+    );
+}
+
+// integer literals (optionally negative), booleans and union cases
+static Node parse_match_value(Parser* p, Lexer* l) {
+    if(CURRENT.type == IDENTIFIER) {
+        Node name = CREATE_NODE(VARIABLE_NODE, variable,
+            .name = CURRENT.content
+        );
+        EXPECT_NEXT();
+        return name;
+    }
+    if(CURRENT.type == BOOLEAN) {
+        Node value = CREATE_NODE(BOOLEAN_LITERAL_NODE, boolean_literal,
+            .value = CURRENT.content
+        );
+        EXPECT_NEXT();
+        return value;
+    }
+    bool is_negative = CURRENT.type == MINUS;
+    if(is_negative) { EXPECT_NEXT(); }
+    EXPECT_TYPE(INTEGER);
+    String digits = CURRENT.content;
+    if(is_negative) {
+        char* negated = (char*) arena_alloc(p->arena, digits.length + 1);
+        negated[0] = '-';
+        memcpy(negated + 1, digits.data, digits.length);
+        digits = string_wrap_nt_slice(negated, digits.length + 1);
+    }
+    EXPECT_NEXT();
+    return CREATE_NODE(INTEGER_LITERAL_NODE, integer_literal,
+        .value = digits
+    );
+}
+
+static Node parse_match(Parser* p, Lexer* l) {
+    EXPECT_NEXT();
+    Node value = PARSE_EXPRESSION();
+    EXPECT_TYPE(BRACE_OPEN);
+    EXPECT_NEXT();
+    ArrayBuilder(MatchArm) ab = arraybuilder_new(MatchArm)();
+    Block else_body = (Block) { .length = 0 };
+    while(CURRENT.type != BRACE_CLOSE) {
+        if(CURRENT.type == KEYWORD_ELSE) {
+            EXPECT_NEXT();
+            EXPECT_TYPE(BRACE_OPEN);
+            EXPECT_NEXT();
+            else_body = PARSE_BLOCK();
+            EXPECT_TYPE(BRACE_CLOSE);
+            EXPECT_NEXT();
+            // the 'else' arm comes last
+            EXPECT_TYPE(BRACE_CLOSE);
+            break;
+        }
+        ArrayBuilder(MatchPattern) pb = arraybuilder_new(MatchPattern)();
+        for(;;) {
+            MatchPattern pattern;
+            pattern.low = ALLOC_NODE(parse_match_value(p, l));
+            pattern.high = NULL;
+            if(CURRENT.type == DOUBLE_DOT) {
+                EXPECT_NEXT();
+                pattern.high = ALLOC_NODE(parse_match_value(p, l));
+            }
+            arraybuilder_push(MatchPattern)(&pb, pattern);
+            if(CURRENT.type != COMMA) { break; }
+            EXPECT_NEXT();
+        }
+        MatchArm arm;
+        // 'case name { ... }' names the value of the case
+        arm.has_binding = CURRENT.type == IDENTIFIER;
+        if(arm.has_binding) {
+            arm.binding = CURRENT.content;
+            EXPECT_NEXT();
+        }
+        EXPECT_TYPE(BRACE_OPEN);
+        EXPECT_NEXT();
+        arm.patternc = pb.length;
+        arm.patternv = (MatchPattern*) arraybuilder_finish(MatchPattern)(
+            &pb, p->arena
+        );
+        arm.body = PARSE_BLOCK();
+        EXPECT_TYPE(BRACE_CLOSE);
+        EXPECT_NEXT();
+        arraybuilder_push(MatchArm)(&ab, arm);
+    }
+    TRY_NEXT();
+    size_t armc = ab.length;
+    return CREATE_NODE(MATCH_NODE, match,
+        .value = ALLOC_NODE(value), .armc = armc,
+        .armv = (MatchArm*) arraybuilder_finish(MatchArm)(&ab, p->arena),
+        .else_body = else_body
+    );
+}
+
 static Node parse_statement(Parser* p, Lexer* l) {
     switch(CURRENT.type) {
         case KEYWORD_VAR:
@@ -488,13 +855,76 @@ static Node parse_statement(Parser* p, Lexer* l) {
                 .pathc = pathc,
                 .pathv = pathv
             );
+        case KEYWORD_WITH: {
+            EXPECT_NEXT();
+            Attributes attributes = parse_attributes(p, l);
+            Node annotated = PARSE_STATEMENT();
+            switch(annotated.type) {
+                case EXTERNAL_FUNCTION_NODE:
+                    check_attributes(&attributes, (const char*[]) {
+                        "pure", "const", NULL
+                    });
+                    annotated.value.external_function.attributes = attributes;
+                    break;
+                case VARIABLE_DECLARATION_NODE:
+                    annotated = global_from_declaration(p, annotated, false);
+                    // falls through - then the same as a global
+                case GLOBAL_NODE:
+                    check_attributes(&attributes, (const char*[]) {
+                        "tls", NULL
+                    });
+                    annotated.value.global.is_thread_local = true;
+                    break;
+                case RECORD_NODE:
+                    check_attributes(&attributes, (const char*[]) {
+                        "align", "cacheline", "reorder", NULL
+                    });
+                    check_alignment(&attributes);
+                    if(annotated.value.record.argc == 0
+                        && (attributes_find(&attributes, "align") != NULL
+                        || attributes_find(&attributes, "cacheline") != NULL)) {
+                        panic("Aligned records need a member!");
+                    }
+                    annotated.value.record.attributes = attributes;
+                    break;
+                case FUNCTION_NODE:
+                    check_attributes(&attributes, (const char*[]) {
+                        "inline", "noinline", "hot", "cold", "flatten", NULL
+                    });
+                    check_function_attributes(&attributes);
+                    annotated.value.function.attributes = attributes;
+                    break;
+                case WHILE_DO_NODE:
+                    check_attributes(&attributes, (const char*[]) {
+                        "unroll", "vectorize", "ivdep", "no_alias",
+                        "likely_trip", NULL
+                    });
+                    check_loop_attributes(&attributes);
+                    annotated.value.while_do.attributes = attributes;
+                    break;
+                default:
+                    panic("Attributes are not allowed here!");
+            }
+            return annotated;
+        }
         case KEYWORD_PUB:
         case KEYWORD_EXT:
         case KEYWORD_FUN:
         case KEYWORD_RECORD:
+        case KEYWORD_UNION:
+        case KEYWORD_CONST:
+        case KEYWORD_ASYNC:
             bool is_public = CURRENT.type == KEYWORD_PUB;
             if(is_public) { EXPECT_NEXT(); }
-            if(CURRENT.type == KEYWORD_EXT) {
+            bool is_async = CURRENT.type == KEYWORD_ASYNC;
+            if(is_async) {
+                EXPECT_NEXT();
+                EXPECT_TYPE(KEYWORD_FUN);
+            }
+            if(CURRENT.type == KEYWORD_VAR) {
+                Node declaration = PARSE_STATEMENT();
+                return global_from_declaration(p, declaration, is_public);
+            } else if(CURRENT.type == KEYWORD_EXT) {
                 EXPECT_NEXT();
                 EXPECT_TYPE(KEYWORD_FUN);
                 EXPECT_NEXT();
@@ -555,7 +985,8 @@ static Node parse_statement(Parser* p, Lexer* l) {
                         &atb, p->arena
                     ),
                     .return_type = ALLOC_NODE(return_type),
-                    .external_name = external_name
+                    .external_name = external_name,
+                    .attributes = (Attributes) { .length = 0 }
                 );
             } else if(CURRENT.type == KEYWORD_FUN) {
                 EXPECT_NEXT();
@@ -577,18 +1008,10 @@ static Node parse_statement(Parser* p, Lexer* l) {
                 };
                 size_t template_argc = 0;
                 String* template_argnamev;
+                Node* template_argtypev;
                 if(CURRENT.type == BRACKET_OPEN) {
-                    EXPECT_NEXT();
-                    ArrayBuilder(String) anb = arraybuilder_new(String)();
-                    while(CURRENT.type != BRACKET_CLOSE) {
-                        EXPECT_TYPE(IDENTIFIER);
-                        arraybuilder_push(String)(&anb, CURRENT.content);
-                        EXPECT_NEXT();
-                    }
-                    EXPECT_NEXT();
-                    template_argc = anb.length;
-                    template_argnamev = (String*) arraybuilder_finish(String)(
-                        &anb, p->arena
+                    template_argc = parse_template_parameters(
+                        p, l, &template_argnamev, &template_argtypev
                     );
                 }
                 ArrayBuilder(String) anb = arraybuilder_new(String)();
@@ -623,9 +1046,10 @@ static Node parse_statement(Parser* p, Lexer* l) {
                 EXPECT_TYPE(BRACE_CLOSE);
                 TRY_NEXT();
                 return CREATE_NODE(FUNCTION_NODE, function,
-                    .is_public = is_public, .path = path,
+                    .is_public = is_public, .is_async = is_async, .path = path,
                     .template_argc = template_argc,
                     .template_argnamev = template_argnamev,
+                    .template_argtypev = template_argtypev,
                     .template_argv = NULL,
                     .argc = anb.length,
                     .argnamev = (String*) arraybuilder_finish(String)(
@@ -657,23 +1081,36 @@ static Node parse_statement(Parser* p, Lexer* l) {
                 };
                 size_t template_argc = 0;
                 String* template_argnamev;
+                Node* template_argtypev;
                 if(CURRENT.type == BRACKET_OPEN) {
-                    EXPECT_NEXT();
-                    ArrayBuilder(String) anb = arraybuilder_new(String)();
-                    while(CURRENT.type != BRACKET_CLOSE) {
-                        EXPECT_TYPE(IDENTIFIER);
-                        arraybuilder_push(String)(&anb, CURRENT.content);
-                        EXPECT_NEXT();
-                    }
-                    EXPECT_NEXT();
-                    template_argc = anb.length;
-                    template_argnamev = (String*) arraybuilder_finish(String)(
-                        &anb, p->arena
+                    template_argc = parse_template_parameters(
+                        p, l, &template_argnamev, &template_argtypev
                     );
                 }
                 ArrayBuilder(String) anb = arraybuilder_new(String)();
                 ArrayBuilder(Node) atb = arraybuilder_new(Node)();
-                while(!AT_END && CURRENT.type == IDENTIFIER) {
+                ArrayBuilder(Attributes) aab = arraybuilder_new(Attributes)();
+                while(!AT_END && (
+                    CURRENT.type == IDENTIFIER || CURRENT.type == KEYWORD_WITH
+                )) {
+                    // each 'with' before a member gives it one attribute
+                    ArrayBuilder(Attribute) ab = arraybuilder_new(Attribute)();
+                    while(CURRENT.type == KEYWORD_WITH) {
+                        EXPECT_NEXT();
+                        arraybuilder_push(Attribute)(
+                            &ab, parse_attribute(p, l)
+                        );
+                    }
+                    Attributes arg_attributes;
+                    arg_attributes.length = ab.length;
+                    arg_attributes.attributes = (Attribute*)
+                        arraybuilder_finish(Attribute)(&ab, p->arena);
+                    check_attributes(&arg_attributes, (const char*[]) {
+                        "align", "cacheline", NULL
+                    });
+                    check_alignment(&arg_attributes);
+                    arraybuilder_push(Attributes)(&aab, arg_attributes);
+                    EXPECT_TYPE(IDENTIFIER);
                     arraybuilder_push(String)(&anb, CURRENT.content);
                     EXPECT_NEXT();
                     Node arg_type = PARSE_TYPE();
@@ -683,6 +1120,7 @@ static Node parse_statement(Parser* p, Lexer* l) {
                     .is_public = is_public, .path = path,
                     .template_argc = template_argc,
                     .template_argnamev = template_argnamev,
+                    .template_argtypev = template_argtypev,
                     .template_argv = NULL,
                     .argc = anb.length,
                     .argnamev = (String*) arraybuilder_finish(String)(
@@ -690,8 +1128,92 @@ static Node parse_statement(Parser* p, Lexer* l) {
                     ),
                     .argtypev = (Node*) arraybuilder_finish(Node)(
                         &atb, p->arena
+                    ),
+                    .attributes = (Attributes) { .length = 0 },
+                    .argattributev = (Attributes*) arraybuilder_finish(
+                        Attributes
+                    )(&aab, p->arena)
+                );
+            } else if(CURRENT.type == KEYWORD_UNION) {
+                EXPECT_NEXT();
+                EXPECT_TYPE(IDENTIFIER);
+                ArrayBuilder(String) pb = arraybuilder_new(String)();
+                arraybuilder_push(String)(&pb, CURRENT.content);
+                EXPECT_NEXT();
+                while(CURRENT.type == DOUBLE_COLON) {
+                    EXPECT_NEXT();
+                    EXPECT_TYPE(IDENTIFIER);
+                    arraybuilder_push(String)(&pb, CURRENT.content);
+                    EXPECT_NEXT();
+                }
+                Namespace path = (Namespace) {
+                    .length = pb.length,
+                    .elements = (String*) arraybuilder_finish(String)(
+                        &pb, p->arena
+                    )
+                };
+                size_t template_argc = 0;
+                String* template_argnamev;
+                Node* template_argtypev;
+                if(CURRENT.type == BRACKET_OPEN) {
+                    template_argc = parse_template_parameters(
+                        p, l, &template_argnamev, &template_argtypev
+                    );
+                }
+                ArrayBuilder(String) cnb = arraybuilder_new(String)();
+                ArrayBuilder(Node) ctb = arraybuilder_new(Node)();
+                while(!AT_END && CURRENT.type == IDENTIFIER) {
+                    for(size_t ci = 0; ci < cnb.length; ci += 1) {
+                        if(string_eq(cnb.buffer[ci], CURRENT.content)) {
+                            panic("Union case is declared twice!");
+                        }
+                    }
+                    arraybuilder_push(String)(&cnb, CURRENT.content);
+                    EXPECT_NEXT();
+                    Node case_type = PARSE_TYPE();
+                    arraybuilder_push(Node)(&ctb, case_type);
+                }
+                if(cnb.length == 0) { panic("Unions need a case!"); }
+                return CREATE_NODE(UNION_NODE, tagged_union,
+                    .is_public = is_public, .path = path,
+                    .template_argc = template_argc,
+                    .template_argnamev = template_argnamev,
+                    .template_argtypev = template_argtypev,
+                    .template_argv = NULL,
+                    .casec = cnb.length,
+                    .casenamev = (String*) arraybuilder_finish(String)(
+                        &cnb, p->arena
+                    ),
+                    .casetypev = (Node*) arraybuilder_finish(Node)(
+                        &ctb, p->arena
                     )
                 );
+            } else if(CURRENT.type == KEYWORD_CONST) {
+                EXPECT_NEXT();
+                EXPECT_TYPE(IDENTIFIER);
+                ArrayBuilder(String) pb = arraybuilder_new(String)();
+                arraybuilder_push(String)(&pb, CURRENT.content);
+                EXPECT_NEXT();
+                while(CURRENT.type == DOUBLE_COLON) {
+                    EXPECT_NEXT();
+                    EXPECT_TYPE(IDENTIFIER);
+                    arraybuilder_push(String)(&pb, CURRENT.content);
+                    EXPECT_NEXT();
+                }
+                Namespace path = (Namespace) {
+                    .length = pb.length,
+                    .elements = (String*) arraybuilder_finish(String)(
+                        &pb, p->arena
+                    )
+                };
+                Node type = PARSE_TYPE();
+                EXPECT_TYPE(EQUALS);
+                EXPECT_NEXT();
+                Node value = PARSE_EXPRESSION();
+                return CREATE_NODE(CONSTANT_NODE, constant,
+                    .is_public = is_public, .path = path,
+                    .type = ALLOC_NODE(type), .value = ALLOC_NODE(value)
+                );
             } else { PARSING_ERROR(); }
         case KEYWORD_RETURN:
             EXPECT_NEXT();
@@ -743,6 +1265,29 @@ static Node parse_statement(Parser* p, Lexer* l) {
             return CREATE_NODE(WHILE_DO_NODE, while_do,
                 .condition = ALLOC_NODE(while_condition), .body = while_body
             );
+        case KEYWORD_MATCH:
+            return parse_match(p, l);
+        case KEYWORD_YIELD:
+            TRY_NEXT();
+            return CREATE_EMPTY_NODE(YIELD_NODE);
+        case KEYWORD_PAR:
+            EXPECT_NEXT();
+            EXPECT_TYPE(IDENTIFIER);
+            String par_index = CURRENT.content;
+            EXPECT_NEXT();
+            Node par_start = PARSE_EXPRESSION();
+            EXPECT_TYPE(DOUBLE_DOT);
+            EXPECT_NEXT();
+            Node par_end = PARSE_EXPRESSION();
+            EXPECT_TYPE(BRACE_OPEN);
+            EXPECT_NEXT();
+            Block par_body = PARSE_BLOCK();
+            EXPECT_TYPE(BRACE_CLOSE);
+            TRY_NEXT();
+            return CREATE_NODE(PAR_NODE, par,
+                .index = par_index, .start = ALLOC_NODE(par_start),
+                .end = ALLOC_NODE(par_end), .body = par_body
+            );
     }
     Node expression = PARSE_EXPRESSION();
     if(p->current.type == EQUALS) {
@@ -776,5 +1321,12 @@ static Block parse_block(Parser* p, Lexer* l) {
 Block parser_parse(Parser* p, Lexer* l) {
     p->at_end = false;
     if(!lexer_next_filtered(l, &p->current)) { return (Block) { .length = 0 }; }
-    return parse_block(p, l);
+    Block b = parse_block(p, l);
+    for(size_t si = 0; si < b.length; si += 1) {
+        if(b.statements[si].type != VARIABLE_DECLARATION_NODE) { continue; }
+        b.statements[si] = global_from_declaration(
+            p, b.statements[si], false
+        );
+    }
+    return b;
 }
\ No newline at end of file
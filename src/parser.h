@@ -9,6 +9,20 @@ typedef struct {
 } Namespace;
 
 
+typedef struct {
+    String name;
+    bool has_value;
+    String value;
+} Attribute;
+
+typedef struct {
+    Attribute* attributes;
+    size_t length;
+} Attributes;
+
+Attribute* attributes_find(Attributes* a, const char* name);
+
+
 typedef enum NodeType {
     UNIT_LITERAL_NODE,
     INTEGER_LITERAL_NODE,
@@ -51,19 +65,48 @@ typedef enum NodeType {
     EXTERNAL_FUNCTION_NODE,
     RETURN_VALUE_NODE,
     RECORD_NODE,
+    UNION_NODE,
+    CONSTANT_NODE,
+    GLOBAL_NODE,
     IF_ELSE_NODE,
     WHILE_DO_NODE,
+    MATCH_NODE,
+    PAR_NODE,
+    AWAIT_NODE,
+    YIELD_NODE,
     CALL_NODE,
-    POINTER_TYPE_NODE
+    POINTER_TYPE_NODE,
+    ARRAY_TYPE_NODE,
+    ARRAY_LITERAL_NODE,
+    INDEX_NODE,
+    SLICE_TYPE_NODE,
+    SLICE_NODE
 } NodeType;
 
 typedef struct Node Node;
 
+// the values 'low..high' (without 'high') or only 'low' if 'high' is NULL,
+// or the name of a union case as a VARIABLE_NODE
+typedef struct {
+    Node* low;
+    Node* high;
+} MatchPattern;
+
 typedef struct Block {
     Node* statements;
     size_t length;
 } Block;
 
+// an arm of a 'match', taken if the value matches any of the patterns,
+// which can name the value of a matched union case
+typedef struct {
+    size_t patternc;
+    MatchPattern* patternv;
+    bool has_binding;
+    String binding;
+    Block body;
+} MatchArm;
+
 typedef struct Node {
     NodeType type;
     union {
@@ -108,12 +151,18 @@ typedef struct Node {
         struct { Node* x; Node* to; } type_conversion;
         struct {
             bool is_public;
+            // a coroutine, which can suspend itself with 'yield' and other
+            // async functions with 'await'
+            bool is_async;
             Namespace path;
+            // the types of value parameters ('[N usize]'), which are
+            // UNIT_LITERAL_NODE for type parameters
             size_t template_argc; String* template_argnamev;
-            Node* template_argv;
+            Node* template_argtypev; Node* template_argv;
             size_t argc; String* argnamev; Node* argtypev;
             Node* return_type;
             Block body;
+            Attributes attributes;
         } function;
         struct {
             bool is_public;
@@ -121,19 +170,60 @@ typedef struct Node {
             size_t argc; String* argnamev; Node* argtypev;
             Node* return_type;
             String external_name;
+            Attributes attributes;
         } external_function;
         struct { bool has_value; Node* value; } return_value;
         struct {
             bool is_public;
             Namespace path;
             size_t template_argc; String* template_argnamev;
-            Node* template_argv;
+            Node* template_argtypev; Node* template_argv;
             size_t argc; String* argnamev; Node* argtypev;
+            Attributes attributes;
+            Attributes* argattributev;
         } record;
+        // a tagged union holding the value of one of its cases, which is
+        // 'unit' for cases without a value
+        struct {
+            bool is_public;
+            Namespace path;
+            size_t template_argc; String* template_argnamev;
+            Node* template_argtypev; Node* template_argv;
+            size_t casec; String* casenamev; Node* casetypev;
+        } tagged_union;
+        struct {
+            bool is_public;
+            Namespace path;
+            Node* type; Node* value;
+        } constant;
+        struct {
+            bool is_public;
+            bool is_thread_local;
+            Namespace path;
+            Node* type; Node* value;
+        } global;
         struct { Node* condition; Block if_body; Block else_body; } if_else;
-        struct { Node* condition; Block body; } while_do;
+        struct {
+            Node* condition; Block body; Attributes attributes;
+        } while_do;
+        struct {
+            Node* value; size_t armc; MatchArm* armv; Block else_body;
+        } match;
+        // runs the body for every 'index' in [start, end) on multiple threads
+        struct { String index; Node* start; Node* end; Block body; } par;
+        // 'call' is a CALL_NODE or NAMESPACE_ACCESS_NODE of an async function
+        struct { Node* call; } await;
         struct { Node* called; size_t argc; Node* argv; } call;
-        struct { Node* to; } pointer_type;
+        // '&const T' can not be written through, '&restrict T' is the only
+        // way to reach its memory while it is used
+        struct { Node* to; bool is_const; bool is_restrict; } pointer_type;
+        // 'length' is an integer literal
+        struct { Node* length; Node* of; } array_type;
+        struct { size_t valuec; Node* valuev; } array_literal;
+        struct { Node* x; Node* index; } index;
+        struct { Node* of; } slice_type;
+        // 'start' and 'end' are NULL if omitted
+        struct { Node* x; Node* start; Node* end; } slice;
     } value;
 } Node;
 
@@ -192,6 +192,7 @@ static Node monomorphize_node(
         case MODULE_NODE:
         case USE_NODE:
         case EXTERNAL_FUNCTION_NODE:
+        case YIELD_NODE:
             return *n;
         MONOMORPHIZE_BIOP(ASSIGNMENT_NODE, assignment, to, value)
         MONOMORPHIZE_BIOP(ADDITION_NODE, addition, a, b)
@@ -218,8 +219,16 @@ static Node monomorphize_node(
         MONOMORPHIZE_MONOOP(DEREF_NODE, deref, x)
         MONOMORPHIZE_MONOOP(ADDRESS_OF_NODE, deref, x)
         MONOMORPHIZE_MONOOP(SIZE_OF_NODE, size_of, t)
+        MONOMORPHIZE_MONOOP(AWAIT_NODE, await, call)
         MONOMORPHIZE_BIOP(TYPE_CONVERSION_NODE, type_conversion, x, to)
-        MONOMORPHIZE_MONOOP(POINTER_TYPE_NODE, pointer_type, to)
+        MONOMORPHIZE_MONOOP(
+            POINTER_TYPE_NODE, pointer_type, to,
+            .is_const = n->value.pointer_type.is_const,
+            .is_restrict = n->value.pointer_type.is_restrict
+        )
+        MONOMORPHIZE_BIOP(ARRAY_TYPE_NODE, array_type, length, of)
+        MONOMORPHIZE_BIOP(INDEX_NODE, index, x, index)
+        MONOMORPHIZE_MONOOP(SLICE_TYPE_NODE, slice_type, of)
         MONOMORPHIZE_BIOP(
             VARIABLE_DECLARATION_NODE, variable_declaration, 
             type, value,
@@ -242,9 +251,46 @@ static Node monomorphize_node(
             WHILE_DO_NODE, while_do, condition,
             .body = monomorphize_block(
                 n->value.while_do.body, symbol, symbols, arena, targs
+            ),
+            .attributes = n->value.while_do.attributes
+        )
+        MONOMORPHIZE_BIOP(
+            PAR_NODE, par, start, end,
+            .index = n->value.par.index,
+            .body = monomorphize_block(
+                n->value.par.body, symbol, symbols, arena, targs
             )
         )
+        case MATCH_NODE: {
+            size_t armc = n->value.match.armc;
+            MatchArm* armv = (MatchArm*) arena_alloc(
+                arena, sizeof(MatchArm) * armc
+            );
+            for(size_t armi = 0; armi < armc; armi += 1) {
+                armv[armi] = n->value.match.armv[armi];
+                armv[armi].body = monomorphize_block(
+                    armv[armi].body, symbol, symbols, arena, targs
+                );
+            }
+            return (Node) {
+                .type = MATCH_NODE,
+                .value = { .match = {
+                    .value = ALLOC_NODE(monomorphize_node(
+                        n->value.match.value, symbol, symbols, arena, targs
+                    )),
+                    .armc = armc,
+                    .armv = armv,
+                    .else_body = monomorphize_block(
+                        n->value.match.else_body, symbol, symbols, arena, targs
+                    )
+                } }
+            };
+        }
         case VARIABLE_NODE: {
+            // values of value parameters
+            Node* targ = targs_lookup(targs, n->value.variable.name);
+            if(targ != NULL && (targ->type == INTEGER_LITERAL_NODE
+                || targ->type == BOOLEAN_LITERAL_NODE)) { return *targ; }
             Namespace var_as_path = (Namespace) {
                 .elements = &n->value.variable.name,
                 .length = 1
@@ -285,9 +331,11 @@ static Node monomorphize_node(
                 .type = FUNCTION_NODE,
                 .value = { .function = {
                     .is_public = n->value.function.is_public,
+                    .is_async = n->value.function.is_async,
                     .path = n->value.function.path,
                     .template_argc = targc,
                     .template_argnamev = n->value.function.template_argnamev,
+                    .template_argtypev = n->value.function.template_argtypev,
                     .template_argv = targv,
                     .argc = argc,
                     .argnamev = n->value.function.argnamev,
@@ -298,7 +346,8 @@ static Node monomorphize_node(
                     )),
                     .body = monomorphize_block(
                         n->value.function.body, symbol, symbols, arena, targs
-                    )
+                    ),
+                    .attributes = n->value.function.attributes
                 } }
             };
         }
@@ -327,13 +376,60 @@ static Node monomorphize_node(
                     .path = n->value.record.path,
                     .template_argc = targc,
                     .template_argnamev = n->value.record.template_argnamev,
+                    .template_argtypev = n->value.record.template_argtypev,
                     .template_argv = targv,
                     .argc = argc,
                     .argnamev = n->value.record.argnamev,
-                    .argtypev = argtypev
+                    .argtypev = argtypev,
+                    .attributes = n->value.record.attributes,
+                    .argattributev = n->value.record.argattributev
+                } }
+            };
+        }
+        case UNION_NODE: {
+            size_t targc = n->value.tagged_union.template_argc;
+            Node* targv = (Node*) arena_alloc(arena, sizeof(Node) * targc);
+            for(size_t argi = 0; argi < targc; argi += 1) {
+                Node* targiv = targs_lookup(
+                    targs, n->value.tagged_union.template_argnamev[argi]
+                );
+                if(targiv == NULL) { panic("SHOULD HAVE A VALUE???"); }
+                targv[argi] = *targiv;
+            }
+            size_t casec = n->value.tagged_union.casec;
+            Node* casetypev = (Node*) arena_alloc(arena, sizeof(Node) * casec);
+            for(size_t casei = 0; casei < casec; casei += 1) {
+                casetypev[casei] = monomorphize_node(
+                    n->value.tagged_union.casetypev + casei, symbol, symbols,
+                    arena, targs
+                );
+            }
+            return (Node) {
+                .type = UNION_NODE,
+                .value = { .tagged_union = {
+                    .is_public = n->value.tagged_union.is_public,
+                    .path = n->value.tagged_union.path,
+                    .template_argc = targc,
+                    .template_argnamev = n->value.tagged_union.template_argnamev,
+                    .template_argtypev = n->value.tagged_union.template_argtypev,
+                    .template_argv = targv,
+                    .casec = casec,
+                    .casenamev = n->value.tagged_union.casenamev,
+                    .casetypev = casetypev
                 } }
             };
         }
+        MONOMORPHIZE_BIOP(
+            CONSTANT_NODE, constant, type, value,
+            .is_public = n->value.constant.is_public,
+            .path = n->value.constant.path
+        )
+        MONOMORPHIZE_BIOP(
+            GLOBAL_NODE, global, type, value,
+            .is_public = n->value.global.is_public,
+            .is_thread_local = n->value.global.is_thread_local,
+            .path = n->value.global.path
+        )
         case RETURN_VALUE_NODE: {
             bool has_value = n->value.return_value.has_value;
             return (Node) {
@@ -347,6 +443,36 @@ static Node monomorphize_node(
                 } }
             };
         }
+        case SLICE_NODE: {
+            #define MONOMORPHIZE_OPTIONAL(x) (x) == NULL? NULL \
+                : ALLOC_NODE(monomorphize_node(x, symbol, symbols, arena, targs))
+            return (Node) {
+                .type = SLICE_NODE,
+                .value = { .slice = {
+                    .x = ALLOC_NODE(monomorphize_node(
+                        n->value.slice.x, symbol, symbols, arena, targs
+                    )),
+                    .start = MONOMORPHIZE_OPTIONAL(n->value.slice.start),
+                    .end = MONOMORPHIZE_OPTIONAL(n->value.slice.end)
+                } }
+            };
+        }
+        case ARRAY_LITERAL_NODE: {
+            size_t valuec = n->value.array_literal.valuec;
+            Node* valuev = (Node*) arena_alloc(arena, sizeof(Node) * valuec);
+            for(size_t valuei = 0; valuei < valuec; valuei += 1) {
+                valuev[valuei] = monomorphize_node(
+                    n->value.array_literal.valuev + valuei, symbol, symbols,
+                    arena, targs
+                );
+            }
+            return (Node) {
+                .type = ARRAY_LITERAL_NODE,
+                .value = { .array_literal = {
+                    .valuec = valuec, .valuev = valuev
+                } }
+            };
+        }
         case CALL_NODE:
             size_t call_argc = n->value.call.argc;
             Node* call_argv = (Node*) arena_alloc(
@@ -381,8 +507,25 @@ static Node monomorphize_node(
             )) {
                 accessed_path = expanded_accessed_path;
             }
-            Symbol* symbol;
-            if(!(symbol = s_table_lookup(symbols, accessed_path))) {
+            size_t core_targc = n->value.namespace_access.template_argc;
+            if(core_targc > 0 && !s_table_lookup(symbols, accessed_path)) {
+                // core types with template arguments (like 'atomic[T]')
+                Node* core_targv = (Node*) arena_alloc(
+                    arena, sizeof(Node) * core_targc
+                );
+                for(size_t argi = 0; argi < core_targc; argi += 1) {
+                    core_targv[argi] = monomorphize_node(
+                        n->value.namespace_access.template_argv + argi,
+                        symbol, symbols, arena, targs
+                    );
+                }
+                Node core_access = *n;
+                core_access.value.namespace_access.template_argv = core_targv;
+                return core_access;
+            }
+            // template arguments are resolved where they are written
+            Symbol* accessed;
+            if(!(accessed = s_table_lookup(symbols, accessed_path))) {
                 return *n;
             }
             size_t targc = n->value.namespace_access.template_argc;
@@ -394,7 +537,7 @@ static Node monomorphize_node(
                 );
             }
             size_t variant = symbol_find_variant(
-                symbol, targc, targv, symbols, arena
+                accessed, targc, targv, symbols, arena
             );
             Node access_node = (Node) {
                 .type = NAMESPACE_ACCESS_NODE,
@@ -410,7 +553,12 @@ static Node monomorphize_node(
 }
 
 
-static bool template_arg_eq(Node* a, Node* b) {
+uint64_t integer_literal_value(Node* n) {
+    STRING_AS_NT(n->value.integer_literal.value, digits);
+    return strtoull(digits, NULL, 10);
+}
+
+bool template_arg_eq(Node* a, Node* b) {
     if(a->type != b->type) { return false; }
     switch(a->type) {
         case NAMESPACE_ACCESS_NODE:
@@ -427,6 +575,9 @@ static bool template_arg_eq(Node* a, Node* b) {
             size_t t_argc_b = b->value.namespace_access.template_argc;
             Node* t_argv_b = b->value.namespace_access.template_argv;
             if(t_argc_a != t_argc_b) { return false; }
+            // monomorphized accesses only differ in their variant
+            if(a->value.namespace_access.variant
+                != b->value.namespace_access.variant) { return false; }
             for(size_t argi = 0; argi < t_argc_a; argi += 1) {
                 if(!template_arg_eq(t_argv_a + argi, t_argv_b + argi)) {
                     return false;
@@ -436,12 +587,53 @@ static bool template_arg_eq(Node* a, Node* b) {
         case POINTER_TYPE_NODE:
             Node* ptr_type_a = a->value.pointer_type.to;
             Node* ptr_type_b = b->value.pointer_type.to;
-            return template_arg_eq(ptr_type_a, ptr_type_b);
+            return a->value.pointer_type.is_const
+                    == b->value.pointer_type.is_const
+                && a->value.pointer_type.is_restrict
+                    == b->value.pointer_type.is_restrict
+                && template_arg_eq(ptr_type_a, ptr_type_b);
+        case ARRAY_TYPE_NODE:
+            return template_arg_eq(
+                    a->value.array_type.length, b->value.array_type.length
+                )
+                && template_arg_eq(
+                    a->value.array_type.of, b->value.array_type.of
+                );
+        case SLICE_TYPE_NODE:
+            return template_arg_eq(
+                a->value.slice_type.of, b->value.slice_type.of
+            );
+        case INTEGER_LITERAL_NODE:
+            return integer_literal_value(a) == integer_literal_value(b);
+        case BOOLEAN_LITERAL_NODE:
+            return string_eq(
+                a->value.boolean_literal.value, b->value.boolean_literal.value
+            );
     }
     panic("UNHANDLED NODE TYPE FOR TEMPLATE ARG! HOW DID THIS PARSE?");
 }
 
 
+// value parameters take integer or boolean literals, type parameters types
+static void check_template_arg(Node* parameter_type, Node* arg) {
+    bool is_integer = arg->type == INTEGER_LITERAL_NODE;
+    bool is_boolean = arg->type == BOOLEAN_LITERAL_NODE;
+    if(parameter_type->type == UNIT_LITERAL_NODE) {
+        if(is_integer || is_boolean) {
+            panic("Template type parameter given a value!");
+        }
+        return;
+    }
+    bool wants_boolean = string_eq(
+        parameter_type->value.namespace_access.path.elements[0],
+        string_wrap_nt("bool")
+    );
+    if(wants_boolean? !is_boolean : !is_integer) {
+        panic("Template value parameter given an invalid value!");
+    }
+}
+
+
 Symbol symbol_new(
     Namespace path, Node node, Namespace definined_in, size_t used_path_count,
     Namespace* used_paths
@@ -464,7 +656,11 @@ size_t symbol_targc(Symbol* s) {
             return s->node.value.function.template_argc;
         case RECORD_NODE:
             return s->node.value.record.template_argc;
+        case UNION_NODE:
+            return s->node.value.tagged_union.template_argc;
         case EXTERNAL_FUNCTION_NODE:
+        case CONSTANT_NODE:
+        case GLOBAL_NODE:
             return 0;
     }
     panic("UNHANDLED SYMBOL TYPE???");
@@ -486,7 +682,13 @@ size_t symbol_find_variant(
                 variant_t_argc = variant->value.record.template_argc;
                 variant_t_argv = variant->value.record.template_argv;
                 break;
+            case UNION_NODE:
+                variant_t_argc = variant->value.tagged_union.template_argc;
+                variant_t_argv = variant->value.tagged_union.template_argv;
+                break;
             case EXTERNAL_FUNCTION_NODE:
+            case CONSTANT_NODE:
+            case GLOBAL_NODE:
                 variant_t_argc = 0;
                 break;
         }
@@ -505,22 +707,35 @@ size_t symbol_find_variant(
     }
     size_t symbol_t_argc;
     String* symbol_t_argnamev;
+    Node* symbol_t_argtypev;
     switch(s->node.type) {
         case FUNCTION_NODE:
             symbol_t_argc = s->node.value.function.template_argc;
             symbol_t_argnamev = s->node.value.function.template_argnamev;
+            symbol_t_argtypev = s->node.value.function.template_argtypev;
             break;
         case RECORD_NODE:
             symbol_t_argc = s->node.value.record.template_argc;
             symbol_t_argnamev = s->node.value.record.template_argnamev;
+            symbol_t_argtypev = s->node.value.record.template_argtypev;
+            break;
+        case UNION_NODE:
+            symbol_t_argc = s->node.value.tagged_union.template_argc;
+            symbol_t_argnamev = s->node.value.tagged_union.template_argnamev;
+            symbol_t_argtypev = s->node.value.tagged_union.template_argtypev;
             break;
         case EXTERNAL_FUNCTION_NODE:
+        case CONSTANT_NODE:
+        case GLOBAL_NODE:
             symbol_t_argc = 0;
             break;
     }
     if(symbol_t_argc != argc) {
         panic("Invalid template arg count!");
     }
+    for(size_t argi = 0; argi < argc; argi += 1) {
+        check_template_arg(symbol_t_argtypev + argi, argv + argi);
+    }
     if(s->variant_count + 1 > s->variants_bsize) {
         s->variants_bsize *= 2;
         s->variants = (Node*) realloc(
@@ -538,6 +753,9 @@ size_t symbol_find_variant(
         case RECORD_NODE:
             variant_node->value.record.template_argv = argv;
             break;
+        case UNION_NODE:
+            variant_node->value.tagged_union.template_argv = argv;
+            break;
     }
     TemplateArgs targs = targs_new();
     for(size_t argi = 0; argi < argc; argi += 1) {
@@ -625,8 +843,11 @@ void collect_symbols(Block ast, SymbolTable* table, Arena* arena) {
                 has_module = true;
                 break;
             case RECORD_NODE:
+            case UNION_NODE:
             case FUNCTION_NODE:
             case EXTERNAL_FUNCTION_NODE:
+            case CONSTANT_NODE:
+            case GLOBAL_NODE:
                 if(!has_module) { panic("Missing module declaration!"); }
                 ArrayBuilder(String) pb = arraybuilder_new(String)();
                 arraybuilder_append(String)(
@@ -637,12 +858,21 @@ void collect_symbols(Block ast, SymbolTable* table, Arena* arena) {
                     case RECORD_NODE: 
                         spath = &n.value.record.path;
                         break;
+                    case UNION_NODE:
+                        spath = &n.value.tagged_union.path;
+                        break;
                     case FUNCTION_NODE:
                         spath = &n.value.function.path;
                         break;
                     case EXTERNAL_FUNCTION_NODE:
                         spath = &n.value.external_function.path;
                         break;
+                    case CONSTANT_NODE:
+                        spath = &n.value.constant.path;
+                        break;
+                    case GLOBAL_NODE:
+                        spath = &n.value.global.path;
+                        break;
                 }
                 arraybuilder_append(String)(
                     &pb, spath->length, spath->elements
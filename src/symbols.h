@@ -1,5 +1,6 @@
 
 #pragma once
+#include <stdint.h>
 #include "parser.h"
 
 
@@ -39,5 +40,8 @@ size_t symbol_find_variant(
 );
 void symbol_free(Symbol* s);
 
+bool template_arg_eq(Node* a, Node* b);
+uint64_t integer_literal_value(Node* n);
+
 
 void collect_symbols(Block ast, SymbolTable* table, Arena* arena);
\ No newline at end of file